@@ -119,6 +119,13 @@ public:
 	void Send( const char *data, std::size_t size );
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size );
 
+	// Send count datagrams to the connected endpoint. Where the platform
+	// supports it (sendmmsg on linux) this is a single syscall, otherwise
+	// it falls back to one Send() per datagram.
+	// A datagram that fails to send is skipped and the rest are still sent.
+	// Returns the number of datagrams handed to the kernel.
+	int SendMultiple( const char * const *data, const std::size_t *sizes, int count );
+
 
 	// Bind a local endpoint to receive incoming data. Endpoint
 	// can be 'any' for the system to choose an endpoint
@@ -45,6 +45,11 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h> // for sockaddr_in
+#include <sys/uio.h> // for iovec
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
 
 #include <signal.h>
 #include <math.h>
@@ -206,6 +211,55 @@ public:
         send( socket_, data, size, 0 );
 	}
 
+	int SendMultiple( const char * const *data, const std::size_t *sizes, int count )
+	{
+		assert( isConnected_ );
+
+#ifdef __linux__
+		// UIO_MAXIOV caps the number of messages per sendmmsg call
+		const int MAX_MESSAGES_PER_CALL = 1024;
+		struct mmsghdr msgs[ MAX_MESSAGES_PER_CALL ];
+		struct iovec iovecs[ MAX_MESSAGES_PER_CALL ];
+
+		// next is the first datagram not yet handed over or skipped
+		int next = 0, sent = 0;
+		while( next < count ){
+			int batchSize = std::min( count - next, MAX_MESSAGES_PER_CALL );
+
+			std::memset( msgs, 0, sizeof(struct mmsghdr) * batchSize );
+			for( int i = 0; i < batchSize; ++i ){
+				iovecs[i].iov_base = (void*)data[ next + i ];
+				iovecs[i].iov_len = sizes[ next + i ];
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int result = sendmmsg( socket_, msgs, batchSize, 0 );
+			if( result < 0 ){
+				if( errno == EINTR )
+					continue;
+				// the first datagram failed (EMSGSIZE, or ECONNREFUSED left
+				// by an earlier icmp error), skip it and send the rest
+				++next;
+				continue;
+			}
+			if( result == 0 )
+				break;
+
+			next += result;
+			sent += result;
+		}
+		return sent;
+#else
+		int sent = 0;
+		for( int i = 0; i < count; ++i ){
+			if( send( socket_, data[i], sizes[i], 0 ) >= 0 )
+				++sent;
+		}
+		return sent;
+#endif
+	}
+
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
 	{
 		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
@@ -289,6 +343,11 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+int UdpSocket::SendMultiple( const char * const *data, const std::size_t *sizes, int count )
+{
+	return impl_->SendMultiple( data, sizes, count );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
@@ -333,6 +392,16 @@ extern "C" /*static*/ void InterruptSignalHandler( int );
 }
 
 
+// room for the largest possible udp datagram
+static const int MAX_DATAGRAM_SIZE = 65536;
+
+// ask for a receive buffer big enough to ride out a burst of large bundles
+// while the listener is busy. the kernel may clamp this (net.core.rmem_max).
+static const int RECEIVE_BUFFER_SIZE = 1024 * 1024 * 4;
+
+typedef std::vector< std::pair< double, AttachedTimerListener > > TimerQueue;
+
+
 class SocketReceiveMultiplexer::Implementation{
 	std::vector< std::pair< PacketListener*, UdpSocket* > > socketListeners_;
 	std::vector< AttachedTimerListener > timerListeners_;
@@ -402,9 +471,162 @@ public:
 		timerListeners_.erase( i );
 	}
 
-    void Run()
+private:
+	void ConfigureReceiveBuffers()
+	{
+		for( std::vector< std::pair< PacketListener*, UdpSocket* > >::iterator i = socketListeners_.begin();
+				i != socketListeners_.end(); ++i ){
+			int size = RECEIVE_BUFFER_SIZE;
+			setsockopt( i->second->impl_->Socket(), SOL_SOCKET, SO_RCVBUF, &size, sizeof(size) );
+		}
+	}
+
+	void InitializeTimerQueue( TimerQueue& timerQueue )
+	{
+		double currentTimeMs = GetCurrentTimeMs();
+
+		for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
+				i != timerListeners_.end(); ++i )
+			timerQueue.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
+		std::sort( timerQueue.begin(), timerQueue.end(), CompareScheduledTimerCalls );
+	}
+
+	// milliseconds until the next timer is due, or -1 if there are none
+	double TimeoutMs( const TimerQueue& timerQueue ) const
+	{
+		if( timerQueue.empty() )
+			return -1;
+
+		double timeoutMs = timerQueue.front().first - GetCurrentTimeMs();
+		return (timeoutMs < 0) ? 0 : timeoutMs;
+	}
+
+	void ExecuteExpiredTimers( TimerQueue& timerQueue )
+	{
+		double currentTimeMs = GetCurrentTimeMs();
+		bool resort = false;
+		for( TimerQueue::iterator i = timerQueue.begin();
+				i != timerQueue.end() && i->first <= currentTimeMs; ++i ){
+
+			i->second.listener->TimerExpired();
+			if( break_ )
+				break;
+
+			i->first += i->second.periodMs;
+			resort = true;
+		}
+		if( resort )
+			std::sort( timerQueue.begin(), timerQueue.end(), CompareScheduledTimerCalls );
+	}
+
+#ifdef __linux__
+	// epoll for readiness, then drain each ready socket with recvmmsg
+	// into a reusable set of full-size datagram slots
+	void RunEpoll()
+	{
+		static const int RECEIVE_SLOT_COUNT = 32;
+
+		int epollFd = epoll_create1( EPOLL_CLOEXEC );
+		if( epollFd < 0 )
+			throw std::runtime_error( "epoll_create1 failed\n" );
+
+		try{
+			// event data is 0 for the break pipe, and socket index + 1 otherwise
+			struct epoll_event event;
+			std::memset( &event, 0, sizeof(event) );
+			event.events = EPOLLIN;
+			event.data.u64 = 0;
+			if( epoll_ctl( epollFd, EPOLL_CTL_ADD, breakPipe_[0], &event ) < 0 )
+				throw std::runtime_error( "epoll_ctl failed\n" );
+
+			for( std::size_t i = 0; i < socketListeners_.size(); ++i ){
+				event.data.u64 = i + 1;
+				if( epoll_ctl( epollFd, EPOLL_CTL_ADD, socketListeners_[i].second->impl_->Socket(), &event ) < 0 )
+					throw std::runtime_error( "epoll_ctl failed\n" );
+			}
+
+			TimerQueue timerQueue_;
+			InitializeTimerQueue( timerQueue_ );
+
+			std::vector< char > slots( (std::size_t)RECEIVE_SLOT_COUNT * MAX_DATAGRAM_SIZE );
+			struct mmsghdr msgs[ RECEIVE_SLOT_COUNT ];
+			struct iovec iovecs[ RECEIVE_SLOT_COUNT ];
+			struct sockaddr_in fromAddrs[ RECEIVE_SLOT_COUNT ];
+
+			std::vector< struct epoll_event > events( socketListeners_.size() + 1 );
+
+			while( !break_ ){
+				double timeoutMs = TimeoutMs( timerQueue_ );
+				int timeout = (timeoutMs < 0) ? -1 : (int)ceil( timeoutMs );
+
+				int eventCount = epoll_wait( epollFd, &events[0], (int)events.size(), timeout );
+				if( eventCount < 0 ){
+					if( break_ ){
+						break;
+					}else if( errno == EINTR ){
+						continue;
+					}else{
+						throw std::runtime_error( "epoll_wait failed\n" );
+					}
+				}
+
+				for( int e = 0; e < eventCount && !break_; ++e ){
+					if( events[e].data.u64 == 0 ){
+						// clear pending data from the asynchronous break pipe
+						char c;
+						read( breakPipe_[0], &c, 1 );
+						continue;
+					}
+
+					std::pair< PacketListener*, UdpSocket* >& socketListener =
+						socketListeners_[ events[e].data.u64 - 1 ];
+					int socket = socketListener.second->impl_->Socket();
+
+					int received;
+					do{
+						for( int i = 0; i < RECEIVE_SLOT_COUNT; ++i ){
+							iovecs[i].iov_base = &slots[ (std::size_t)i * MAX_DATAGRAM_SIZE ];
+							iovecs[i].iov_len = MAX_DATAGRAM_SIZE;
+							std::memset( &msgs[i], 0, sizeof(msgs[i]) );
+							msgs[i].msg_hdr.msg_iov = &iovecs[i];
+							msgs[i].msg_hdr.msg_iovlen = 1;
+							msgs[i].msg_hdr.msg_name = &fromAddrs[i];
+							msgs[i].msg_hdr.msg_namelen = sizeof(fromAddrs[i]);
+						}
+
+						received = recvmmsg( socket, msgs, RECEIVE_SLOT_COUNT, MSG_DONTWAIT, 0 );
+
+						for( int i = 0; i < received; ++i ){
+							if( msgs[i].msg_len == 0 || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) )
+								continue;
+
+							IpEndpointName remoteEndpoint(
+									ntohl( fromAddrs[i].sin_addr.s_addr ), ntohs( fromAddrs[i].sin_port ) );
+							socketListener.first->ProcessPacket(
+									(const char*)iovecs[i].iov_base, (int)msgs[i].msg_len, remoteEndpoint );
+							if( break_ )
+								break;
+						}
+						// a full batch means there may be more waiting
+					}while( received == RECEIVE_SLOT_COUNT && !break_ );
+				}
+
+				if( break_ )
+					break;
+
+				ExecuteExpiredTimers( timerQueue_ );
+			}
+		}catch(...){
+			close( epollFd );
+			throw;
+		}
+
+		close( epollFd );
+	}
+#endif
+
+	void RunSelect()
 	{
-		break_ = false;
         char *data = 0;
         
         try{
@@ -431,17 +653,10 @@ public:
 
 
             // configure the timer queue
-            double currentTimeMs = GetCurrentTimeMs();
-
-            // expiry time ms, listener
-            std::vector< std::pair< double, AttachedTimerListener > > timerQueue_;
-            for( std::vector< AttachedTimerListener >::iterator i = timerListeners_.begin();
-                    i != timerListeners_.end(); ++i )
-                timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
-            std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+            TimerQueue timerQueue_;
+            InitializeTimerQueue( timerQueue_ );
 
-            const int MAX_BUFFER_SIZE = 4098;
-            data = new char[ MAX_BUFFER_SIZE ];
+            data = new char[ MAX_DATAGRAM_SIZE ];
             IpEndpointName remoteEndpoint;
 
             struct timeval timeout;
@@ -450,11 +665,8 @@ public:
                 tempfds = masterfds;
 
                 struct timeval *timeoutPtr = 0;
-                if( !timerQueue_.empty() ){
-                    double timeoutMs = timerQueue_.front().first - GetCurrentTimeMs();
-                    if( timeoutMs < 0 )
-                        timeoutMs = 0;
-                
+                double timeoutMs = TimeoutMs( timerQueue_ );
+                if( timeoutMs >= 0 ){
                     long timoutSecondsPart = (long)(timeoutMs * .001);
                     timeout.tv_sec = (time_t)timoutSecondsPart;
                     // 1000000 microseconds in a second
@@ -490,7 +702,7 @@ public:
 
                     if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
 
-                        std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
+                        std::size_t size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_DATAGRAM_SIZE );
                         if( size > 0 ){
                             i->first->ProcessPacket( data, (int)size, remoteEndpoint );
                             if( break_ )
@@ -500,20 +712,7 @@ public:
                 }
 
                 // execute any expired timers
-                currentTimeMs = GetCurrentTimeMs();
-                bool resort = false;
-                for( std::vector< std::pair< double, AttachedTimerListener > >::iterator i = timerQueue_.begin();
-                        i != timerQueue_.end() && i->first <= currentTimeMs; ++i ){
-
-                    i->second.listener->TimerExpired();
-                    if( break_ )
-                        break;
-
-                    i->first += i->second.periodMs;
-                    resort = true;
-                }
-                if( resort )
-                    std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
+                ExecuteExpiredTimers( timerQueue_ );
             }
 
             delete [] data;
@@ -524,6 +723,20 @@ public:
         }
 	}
 
+public:
+    void Run()
+	{
+		break_ = false;
+
+		ConfigureReceiveBuffers();
+
+#ifdef __linux__
+		RunEpoll();
+#else
+		RunSelect();
+#endif
+	}
+
     void Break()
 	{
 		break_ = true;
@@ -199,6 +199,18 @@ public:
         send( socket_, data, (int)size, 0 );
 	}
 
+	int SendMultiple( const char * const *data, const std::size_t *sizes, int count )
+	{
+		assert( isConnected_ );
+
+		int sent = 0;
+		for( int i = 0; i < count; ++i ){
+			if( send( socket_, data[i], (int)sizes[i], 0 ) != SOCKET_ERROR )
+				++sent;
+		}
+		return sent;
+	}
+
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size )
 	{
 		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
@@ -282,6 +294,11 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+int UdpSocket::SendMultiple( const char * const *data, const std::size_t *sizes, int count )
+{
+	return impl_->SendMultiple( data, sizes, count );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
@@ -26,8 +26,6 @@ struct OSCctrl : Module {
   UdpListeningReceiveSocket* RxSocket = NULL;
 	std::thread oscListenerThread;
 
-  rack::dsp::ClockDivider fpsDivider;
-
 	OSCctrl() {
 		config(PARAMS_LEN, INPUTS_LEN, OUTPUTS_LEN, LIGHTS_LEN);
 	}
@@ -37,11 +35,30 @@ struct OSCctrl : Module {
     startListener();
 
     controller.setModuleId(id);
+    controller.setPacketListener(&router);
     router.SetController(&controller);
 
-    router.AddRoute("/rx/module", &OscController::rxModule);
-    router.AddRoute("/rx/cable", &OscController::rxCable);
-    router.AddRoute("/update/param", &OscController::updateParam);
+    router.AddRoute("/rx/module", &OscController::rxModule, ROUTE_DEFAULT_ARGS);
+    router.AddRoute("/rx/cable", &OscController::rxCable, ROUTE_DEFAULT_ARGS);
+    router.AddRoute("/rx/menu", &OscController::rxMenu, ROUTE_DEFAULT_ARGS);
+    router.AddRoute("/strings/clear", &OscController::clearStrings, ROUTE_DEFAULT_ARGS);
+    router.AddRoute("/update/param", &OscController::updateParam, ROUTE_DEFAULT_ARGS);
+    router.AddRoute("/update/params", &OscController::updateParams);
+    router.AddScheduledRoute("/update/param", &OscController::scheduleParamUpdate, ROUTE_DEFAULT_ARGS);
+    router.AddScheduledRoute("/update/params", &OscController::scheduleParamUpdates);
+    router.AddRoute("/clock/sync", &OscController::clockSync);
+    router.AddRoute("/lights/config", &OscController::configureLights, ROUTE_DEFAULT_ARGS);
+    router.AddRoute("/sync/rate", &OscController::setSyncRate);
+    router.AddRoute("/pacing", &OscController::setPacing);
+    router.AddRoute("/bundle/max_payload", &OscController::setMaxBundlePayloadSize);
+    router.AddRoute("/encoder/threads", &OscController::setEncoderThreads);
+    router.AddRoute("/stats/rt", &OscController::sendRtStats);
+    router.AddRoute("/subscribe/module", &OscController::subscribeModule);
+    router.AddRoute("/unsubscribe/module", &OscController::unsubscribeModule);
+    router.AddRoute("/interest/set", &OscController::setInterest);
+    // either part may be an osc pattern, e.g. /update/param/<module>/*
+    router.AddRoute("/update/param/#/#", &OscController::updateParamPattern, ROUTE_MATCHES_PATTERNS);
+    router.AddRoute("/reset/param/#/#", &OscController::resetParamPattern, ROUTE_MATCHES_PATTERNS);
   }
 
   void onRemove(const RemoveEvent& e) override {
@@ -79,6 +96,7 @@ struct OSCctrl : Module {
 
   void cleanupListener() {
     DEBUG("OSCctrl cleanupListener");
+    controller.Shm.close();
     if (RxSocket == NULL) return;
 
     RxSocket->AsynchronousBreak();
@@ -92,16 +110,7 @@ struct OSCctrl : Module {
   }
 
 	void process(const ProcessArgs& args) override {
-    if (fpsDivider.getDivision() == 1) {
-      fpsDivider.setDivision((uint32_t)(args.sampleRate / 60));
-    }
-
-    if (fpsDivider.process() && !controller.needsSync) {
-      controller.enqueueLightUpdates();
-      controller.processParamUpdates();
-      controller.processMenuQuantityUpdates();
-      controller.processModuleDiffs();
-    }
+    controller.processAudio(args.frame, args.sampleTime);
 	}
 };
 
@@ -133,10 +142,9 @@ struct OSCctrlWidget : ModuleWidget {
     }
 
     if (ctrl.needsSync) ctrl.collectAndSync();
-    ctrl.processCableUpdates();
-    ctrl.processModuleUpdates();
-    ctrl.processMenuRequests();
-    ctrl.processMenuClicks();
+    ctrl.processIngress();
+    if (ctrl.takeDue(SyncStream::ParamStream)) ctrl.processParamUpdates();
+    if (ctrl.takeDue(SyncStream::DiffStream)) ctrl.processDiffs();
   }
 };
 
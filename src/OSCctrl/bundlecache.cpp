@@ -0,0 +1,69 @@
+#include "bundlecache.hpp"
+
+BundleCache::Entry BundleCache::find(int64_t moduleId, uint64_t version) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::unordered_map<int64_t, Entry>::iterator it = entries.find(moduleId);
+  if (it == entries.end() || it->second->version != version) {
+    ++misses;
+    return Entry();
+  }
+
+  ++hits;
+  return it->second;
+}
+
+BundleCache::Entry BundleCache::store(int64_t moduleId, uint64_t version, const Bundler& bundler) {
+  std::shared_ptr<EncodedBundle> bundle = std::make_shared<EncodedBundle>();
+  bundle->version = version;
+
+  for (int i = 0; i < bundler.chunkCount(); i++) {
+    std::size_t offset = bundle->bytes.size();
+    std::size_t size = bundler.chunkSize(i);
+    bundle->bytes.resize(offset + size);
+    bundle->chunks.emplace_back(offset, bundler.writeChunk(i, bundle->bytes.data() + offset, size));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Entry& entry = entries[moduleId];
+  if (entry && entry->version > version) return bundle;
+
+  if (entry) bytes -= entry->bytes.size();
+  bytes += bundle->bytes.size();
+  entry = bundle;
+  return entry;
+}
+
+void BundleCache::erase(int64_t moduleId) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::unordered_map<int64_t, Entry>::iterator it = entries.find(moduleId);
+  if (it == entries.end()) return;
+
+  bytes -= it->second->bytes.size();
+  entries.erase(it);
+}
+
+void BundleCache::prune(const std::function<bool(int64_t)>& keep) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (std::unordered_map<int64_t, Entry>::iterator it = entries.begin(); it != entries.end();) {
+    if (keep(it->first)) {
+      ++it;
+      continue;
+    }
+    bytes -= it->second->bytes.size();
+    it = entries.erase(it);
+  }
+}
+
+void BundleCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  bytes = 0;
+}
+
+BundleCache::Stats BundleCache::getStats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return Stats{hits, misses, entries.size(), bytes};
+}
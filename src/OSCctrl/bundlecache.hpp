@@ -0,0 +1,60 @@
+#pragma once
+#include "bundler.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// a module sync as it went out, chunk for chunk
+struct EncodedBundle {
+  uint64_t version;
+  std::vector<char> bytes;
+  std::vector<std::pair<std::size_t, std::size_t>> chunks;
+
+  int chunkCount() const { return chunks.size(); }
+  const char* chunkData(int index) const { return bytes.data() + chunks[index].first; }
+  std::size_t chunkSize(int index) const { return chunks[index].second; }
+};
+
+// the last encoded sync of each module, keyed by module id and the
+// content version it was encoded from. a resync of a module whose
+// version hasn't moved replays these bytes instead of encoding again.
+//
+// entries go stale by themselves when a module's version is bumped, and
+// the whole cache is dropped when the bytes can no longer be replayed
+// as they are (string table or chunk size changed).
+struct BundleCache {
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    std::size_t entries;
+    std::size_t bytes;
+  };
+
+  typedef std::shared_ptr<const EncodedBundle> Entry;
+
+  // null unless `moduleId` was stored at exactly `version`
+  Entry find(int64_t moduleId, uint64_t version);
+  // copies the chunks of a finished bundler, an older version
+  // never replaces a newer one
+  Entry store(int64_t moduleId, uint64_t version, const Bundler& bundler);
+
+  void erase(int64_t moduleId);
+  // drops every module `keep` returns false for
+  void prune(const std::function<bool(int64_t)>& keep);
+  void clear();
+
+  Stats getStats();
+
+private:
+  std::mutex mutex;
+  std::unordered_map<int64_t, Entry> entries;
+  std::size_t bytes{0};
+  uint64_t hits{0};
+  uint64_t misses{0};
+};
@@ -0,0 +1,105 @@
+#include "bundler.hpp"
+
+#include <rack.hpp>
+
+#include <cstring>
+
+// "#bundle\0" followed by the 8 byte timetag
+#define BUNDLE_HEADER_SIZE 16
+
+Bundler::Bundler(std::size_t _maxPayloadSize)
+  : maxPayloadSize(_maxPayloadSize),
+    scratch(BUNDLER_SCRATCH_SIZE),
+    groupStream(scratch.data(), scratch.size()) {}
+
+void Bundler::begin() {
+  groupBytes.clear();
+  groups.clear();
+  chunks.clear();
+}
+
+osc::OutboundPacketStream& Bundler::beginGroup() {
+  groupStream.Clear();
+  groupStream << osc::BeginBundleImmediate;
+  return groupStream;
+}
+
+void Bundler::endGroup() {
+  groupStream << osc::EndBundle;
+
+  std::size_t size = groupStream.Size() - BUNDLE_HEADER_SIZE;
+  if (size == 0) return;
+
+  const char* elements = groupStream.Data() + BUNDLE_HEADER_SIZE;
+  groups.emplace_back(groupBytes.size(), size);
+  groupBytes.insert(groupBytes.end(), elements, elements + size);
+}
+
+void Bundler::finish(int64_t _tagId) {
+  tagId = _tagId;
+  tagSize = 0;
+  if (groups.empty()) return;
+
+  if (tagId != -1) {
+    groupStream.Clear();
+    groupStream << osc::BeginBundleImmediate
+      << osc::BeginMessage("/module_sync_chunk")
+      << tagId
+      << 0
+      << 0
+      << osc::EndMessage
+      << osc::EndBundle;
+    tagSize = groupStream.Size() - BUNDLE_HEADER_SIZE;
+  }
+
+  std::size_t budget =
+    maxPayloadSize > BUNDLE_HEADER_SIZE + tagSize
+      ? maxPayloadSize - BUNDLE_HEADER_SIZE - tagSize
+      : 0;
+
+  // greedily fill chunks
+  std::size_t first{0}, used{0};
+  for (std::size_t i = 0; i < groups.size(); i++) {
+    std::size_t size = groups[i].second;
+
+    if (size > budget)
+      WARN("bundle group of %lld bytes exceeds payload size %lld", (long long)size, (long long)maxPayloadSize);
+
+    if (i > first && used + size > budget) {
+      chunks.emplace_back(first, i);
+      first = i;
+      used = 0;
+    }
+    used += size;
+  }
+  chunks.emplace_back(first, groups.size());
+}
+
+std::size_t Bundler::elementsSize(int index) const {
+  const std::pair<std::size_t, std::size_t>& groupsFirst = groups[chunks[index].first];
+  const std::pair<std::size_t, std::size_t>& groupsLast = groups[chunks[index].second - 1];
+  return groupsLast.first + groupsLast.second - groupsFirst.first;
+}
+
+std::size_t Bundler::chunkSize(int index) const {
+  return BUNDLE_HEADER_SIZE + tagSize + elementsSize(index);
+}
+
+std::size_t Bundler::writeChunk(int index, char* data, std::size_t capacity) const {
+  std::size_t size = chunkSize(index);
+  if (size > capacity) return 0;
+
+  osc::OutboundPacketStream stream(data, capacity);
+  stream << osc::BeginBundleImmediate;
+  if (tagId != -1) {
+    stream << osc::BeginMessage("/module_sync_chunk")
+      << tagId
+      << index
+      << (int)chunks.size()
+      << osc::EndMessage;
+  }
+
+  std::size_t offset = stream.Size();
+  std::memcpy(data + offset, groupBytes.data() + groups[chunks[index].first].first, elementsSize(index));
+  return size;
+}
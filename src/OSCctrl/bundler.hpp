@@ -0,0 +1,64 @@
+#pragma once
+#include "../../dep/oscpack/osc/OscOutboundPacketStream.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// keep datagrams well clear of the 64k udp limit, smaller chunks also
+// spread better across the client's receive buffer
+#define DEFAULT_BUNDLE_PAYLOAD_SIZE (1024 * 16)
+#define MIN_BUNDLE_PAYLOAD_SIZE 1024
+// largest udp payload
+#define MAX_BUNDLE_PAYLOAD_SIZE 65507
+#define BUNDLER_SCRATCH_SIZE (1024 * 64)
+
+// splits what would be one oversized bundle into a series of bundles no
+// larger than `maxPayloadSize`.
+//
+// messages are written in groups, and a group (a param and its lights,
+// say) is never split across bundles. groups keep their order, so a
+// trailing `/module_sync_complete` is always in the final chunk.
+// when finished with a tag id, each chunk leads with
+// `/module_sync_chunk <id> <index> <count>`.
+//
+// `finish` only lays the chunks out, each one is written straight into
+// the caller's buffer (a PacketBuffer, usually) with `writeChunk`.
+struct Bundler {
+  Bundler(std::size_t _maxPayloadSize = DEFAULT_BUNDLE_PAYLOAD_SIZE);
+
+  void setMaxPayloadSize(std::size_t size) { maxPayloadSize = size; }
+  std::size_t getMaxPayloadSize() const { return maxPayloadSize; }
+
+  void begin();
+
+  // write a group's messages into the returned stream, then `endGroup`
+  osc::OutboundPacketStream& beginGroup();
+  void endGroup();
+
+  void finish(int64_t tagId = -1);
+
+  int chunkCount() const { return chunks.size(); }
+  std::size_t chunkSize(int index) const;
+  // returns the bytes written, 0 if the chunk doesn't fit in `capacity`
+  std::size_t writeChunk(int index, char* data, std::size_t capacity) const;
+
+private:
+  std::size_t maxPayloadSize;
+
+  std::vector<char> scratch;
+  osc::OutboundPacketStream groupStream;
+
+  // bundle elements (size-prefixed messages) of each committed group,
+  // pairs are (offset, size) into groupBytes
+  std::vector<char> groupBytes;
+  std::vector<std::pair<std::size_t, std::size_t>> groups;
+
+  // [first, last) ranges of groups
+  std::vector<std::pair<std::size_t, std::size_t>> chunks;
+  int64_t tagId{-1};
+  std::size_t tagSize{0};
+
+  std::size_t elementsSize(int index) const;
+};
@@ -0,0 +1,313 @@
+#include "commandqueue.hpp"
+
+CommandPriority CommandQueue::priorityOf(CommandType type) {
+  switch (type) {
+    case CommandType::SyncParam:
+    case CommandType::SyncPort:
+    case CommandType::SyncMenu:
+    case CommandType::Noop:
+      return CommandPriority::Interactive;
+    case CommandType::UpdateLights:
+      return CommandPriority::Lights;
+    case CommandType::SyncModule:
+    case CommandType::SyncCable:
+    case CommandType::SyncLibrary:
+    default:
+      return CommandPriority::Bulk;
+  }
+}
+
+
+CommandRing::CommandRing(std::size_t _size) : cells(new Cell[_size]), mask(_size - 1) {
+  for (std::size_t i = 0; i < _size; i++)
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool CommandRing::push(const QueuedCommand& command) {
+  std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+  Cell* cell;
+
+  for (;;) {
+    cell = &cells[position & mask];
+    std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+    if (difference == 0) {
+      if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+    } else if (difference < 0) {
+      return false;
+    } else {
+      position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->command = command;
+  cell->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool CommandRing::popMatching(bool any, CommandType type, QueuedCommand& command) {
+  std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+  Cell* cell;
+
+  for (;;) {
+    cell = &cells[position & mask];
+    std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+    if (difference == 0) {
+      // a full cell isn't reused until it's released below, so if the
+      // claim succeeds this is still what it holds
+      if (!any && cell->command.type != type) return false;
+      if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+    } else if (difference < 0) {
+      return false;
+    } else {
+      position = dequeuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  command = cell->command;
+  cell->sequence.store(position + mask + 1, std::memory_order_release);
+  return true;
+}
+
+bool CommandRing::pop(QueuedCommand& command) {
+  return popMatching(true, CommandType::Noop, command);
+}
+
+bool CommandRing::popIf(CommandType type, QueuedCommand& command) {
+  return popMatching(false, type, command);
+}
+
+bool CommandRing::empty() const {
+  std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+  return cells[position & mask].sequence.load(std::memory_order_acquire) != position + 1;
+}
+
+#define TARGET_EMPTY 0u
+#define TARGET_CLAIMING 1u
+#define TARGET_PENDING 2u
+#define TARGET_FREE 3u
+#define TARGET_STATUS 3u
+
+CommandQueue::CommandQueue() : pendingTargets(new PendingTarget[PENDING_TARGET_TABLE_SIZE]) {
+  for (std::size_t i = 0; i < PENDING_TARGET_TABLE_SIZE; i++)
+    pendingTargets[i].state.store(TARGET_EMPTY, std::memory_order_relaxed);
+}
+
+int CommandQueue::claimTarget(const QueuedCommand& command, bool& duplicate) {
+  duplicate = false;
+
+  int type = command.type;
+  int cid = command.cid;
+  // inputs and outputs share ids
+  if (command.type == CommandType::SyncPort && command.portType == PortType::Output)
+    cid = -cid - 1;
+
+  uint64_t hash = (uint64_t)command.pid * 0x9e3779b97f4a7c15ull;
+  hash ^= ((uint64_t)(uint32_t)cid << 8 | type) * 0xff51afd7ed558ccdull;
+  hash ^= hash >> 32;
+
+  // every failed compare-exchange means someone else got somewhere, start over
+  for (int attempt = 0; attempt < MAX_PENDING_TARGET_PROBES; attempt++) {
+    int reusable = -1;
+    uint32_t reusableState = 0;
+    bool changed = false;
+
+    for (int probe = 0; probe < MAX_PENDING_TARGET_PROBES; probe++) {
+      int index = (hash + probe) & (PENDING_TARGET_TABLE_SIZE - 1);
+      PendingTarget& target = pendingTargets[index];
+
+      uint32_t state = target.state.load(std::memory_order_acquire);
+      // someone else is claiming it, wait to see whose target it is
+      while ((state & TARGET_STATUS) == TARGET_CLAIMING) state = target.state.load(std::memory_order_acquire);
+
+      if ((state & TARGET_STATUS) == TARGET_EMPTY) {
+        if (reusable == -1) {
+          reusable = index;
+          reusableState = state;
+        }
+        break;
+      }
+
+      bool same =
+        target.pid.load(std::memory_order_relaxed) == command.pid
+        && target.cid.load(std::memory_order_relaxed) == cid
+        && target.type.load(std::memory_order_relaxed) == type;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (target.state.load(std::memory_order_relaxed) != state) {
+        changed = true;
+        break;
+      }
+
+      if (same) {
+        if ((state & TARGET_STATUS) == TARGET_PENDING) {
+          duplicate = true;
+          return -1;
+        }
+        if (target.state.compare_exchange_strong(state, (state & ~TARGET_STATUS) | TARGET_PENDING, std::memory_order_acquire))
+          return index;
+        changed = true;
+        break;
+      }
+
+      if ((state & TARGET_STATUS) == TARGET_FREE && reusable == -1) {
+        reusable = index;
+        reusableState = state;
+      }
+    }
+
+    if (changed) continue;
+    if (reusable == -1) return -1;
+
+    PendingTarget& target = pendingTargets[reusable];
+    uint32_t version = ((reusableState >> 2) + 1) << 2;
+    if (!target.state.compare_exchange_strong(reusableState, version | TARGET_CLAIMING, std::memory_order_relaxed))
+      continue;
+
+    std::atomic_thread_fence(std::memory_order_release);
+    target.pid.store(command.pid, std::memory_order_relaxed);
+    target.cid.store(cid, std::memory_order_relaxed);
+    target.type.store(type, std::memory_order_relaxed);
+    target.state.store(version | TARGET_PENDING, std::memory_order_release);
+    return reusable;
+  }
+
+  return -1;
+}
+
+// only the holder of a pending slot releases it
+void CommandQueue::releaseTarget(int index) {
+  PendingTarget& target = pendingTargets[index];
+  uint32_t state = target.state.load(std::memory_order_relaxed);
+  target.state.store((state & ~TARGET_STATUS) | TARGET_FREE, std::memory_order_release);
+}
+
+bool CommandQueue::push(const QueuedCommand& command) {
+  QueuedCommand queued = command;
+  queued.target = -1;
+
+  switch (command.type) {
+    case CommandType::UpdateLights:
+      return !lightsPending.exchange(true);
+    case CommandType::SyncParam:
+    case CommandType::SyncPort: {
+      bool duplicate;
+      queued.target = claimTarget(command, duplicate);
+      if (duplicate) {
+        deduplicated.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  if (priorityOf(command.type) == CommandPriority::Bulk) {
+    if (hasOverflow.load(std::memory_order_acquire) || !bulk.push(queued)) pushOverflow(queued);
+    return true;
+  }
+
+  if (!interactive.push(queued)) {
+    if (queued.target != -1) releaseTarget(queued.target);
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+void CommandQueue::pushOverflow(const QueuedCommand& command) {
+  std::lock_guard<std::mutex> lock(overflowMutex);
+  overflow.push_back(command);
+  hasOverflow.store(true, std::memory_order_release);
+  overflowed.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool CommandQueue::popOverflow(bool any, CommandType type, QueuedCommand& command) {
+  if (!hasOverflow.load(std::memory_order_acquire)) return false;
+
+  std::lock_guard<std::mutex> lock(overflowMutex);
+  if (overflow.empty() || (!any && overflow.front().type != type)) return false;
+
+  command = overflow.front();
+  overflow.pop_front();
+  if (overflow.empty()) hasOverflow.store(false, std::memory_order_release);
+  return true;
+}
+
+bool CommandQueue::pop(QueuedCommand& command, CommandPriority& priority) {
+  if (interactive.pop(command)) {
+    priority = CommandPriority::Interactive;
+
+    // from here on a new request has to queue again
+    if (command.target != -1) releaseTarget(command.target);
+    return true;
+  }
+
+  if (lightsPending.exchange(false)) {
+    command = QueuedCommand(CommandType::UpdateLights);
+    priority = CommandPriority::Lights;
+    return true;
+  }
+
+  // the ring only holds what was queued before the overflow started
+  if (bulk.pop(command) || popOverflow(true, CommandType::Noop, command)) {
+    priority = CommandPriority::Bulk;
+    return true;
+  }
+
+  return false;
+}
+
+void CommandQueue::popRun(CommandType type, std::vector<QueuedCommand>& commands, std::size_t max) {
+  QueuedCommand command;
+  while (commands.size() < max) {
+    if (bulk.popIf(type, command)) {
+      commands.push_back(command);
+    } else if (bulk.empty() && popOverflow(false, type, command)) {
+      commands.push_back(command);
+    } else {
+      break;
+    }
+  }
+}
+
+bool CommandQueue::peek(CommandPriority& priority) const {
+  if (!interactive.empty()) {
+    priority = CommandPriority::Interactive;
+  } else if (lightsPending) {
+    priority = CommandPriority::Lights;
+  } else if (!bulk.empty() || hasOverflow.load(std::memory_order_acquire)) {
+    priority = CommandPriority::Bulk;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void CommandQueue::clear() {
+  QueuedCommand command;
+  while (interactive.pop(command)) {
+    if (command.target != -1) releaseTarget(command.target);
+  }
+  while (bulk.pop(command)) {}
+  lightsPending = false;
+
+  std::lock_guard<std::mutex> lock(overflowMutex);
+  overflow.clear();
+  hasOverflow.store(false, std::memory_order_release);
+}
+
+bool CommandQueue::empty() const {
+  return !lightsPending && interactive.empty() && bulk.empty() && !hasOverflow.load(std::memory_order_acquire);
+}
+
+CommandQueue::Stats CommandQueue::getStats() const {
+  return Stats{
+    dropped.load(std::memory_order_relaxed),
+    deduplicated.load(std::memory_order_relaxed),
+    overflowed.load(std::memory_order_relaxed)
+  };
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include <rack.hpp>
+#include "../VCVStructure.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using Time = std::chrono::steady_clock;
+using float_sec = std::chrono::duration<float>;
+using float_time_point = std::chrono::time_point<Time, float_sec>;
+
+enum CommandType {
+  SyncCable,
+  SyncModule,
+  SyncLibrary,
+  UpdateLights,
+  SyncParam,
+  SyncPort,
+  SyncMenu,
+  Noop
+};
+struct Payload {
+  int64_t pid;
+  int cid, gcid;
+
+  Time::time_point lastCheck;
+  float wait;
+
+  int retried = 0;
+  int retryLimit = 10;
+
+  PortType portType;
+
+  Payload() {}
+  Payload(int64_t _pid) : pid(_pid) {}
+  Payload(int64_t _pid, int _cid) : pid(_pid), cid(_cid) {}
+  Payload(int64_t _pid, int _cid, PortType _portType) : pid(_pid), cid(_cid), portType(_portType) {}
+  Payload(int64_t _pid, Time::time_point _lastCheck, float _wait) : pid(_pid), lastCheck(_lastCheck), wait(_wait) {}
+  Payload(int64_t _pid, int _cid, Time::time_point _lastCheck, float _wait) : pid(_pid), cid(_cid), lastCheck(_lastCheck), wait(_wait) {}
+
+  Time::time_point deadline() const {
+    return lastCheck + std::chrono::duration_cast<Time::duration>(float_sec(wait));
+  }
+};
+typedef std::pair<CommandType, Payload> Command;
+
+// served strictly in this order. interactive echoes of what the user is
+// touching never wait behind more than the one bulk command in progress.
+enum CommandPriority {
+  Interactive,
+  Lights,
+  Bulk,
+  PRIORITY_COUNT
+};
+
+// both must be powers of two. a full interactive ring drops (and counts)
+// what doesn't fit rather than allocating. structural syncs are never
+// dropped, bulk that doesn't fit goes to an overflow list instead.
+#define INTERACTIVE_COMMAND_RING_SIZE 4096
+#define BULK_COMMAND_RING_SIZE 16384
+// param/port sync targets tracked for dedup. only queued syncs hold a
+// slot, and they all sit in the interactive ring, so at most half the
+// table is ever in use however large the patch.
+#define PENDING_TARGET_TABLE_SIZE (INTERACTIVE_COMMAND_RING_SIZE * 2)
+#define MAX_PENDING_TARGET_PROBES 32
+
+// what travels through the queue. retry bookkeeping only exists for
+// syncs that are waiting on an ack, see Command.
+struct QueuedCommand {
+  int64_t pid;
+  int cid;
+  CommandType type;
+  PortType portType;
+  // the pending target slot it holds, set by CommandQueue::push
+  int target;
+
+  QueuedCommand() : pid(-1), cid(-1), type(CommandType::Noop), portType(PortType::Input), target(-1) {}
+  QueuedCommand(CommandType _type, int64_t _pid = -1, int _cid = -1, PortType _portType = PortType::Input)
+    : pid(_pid), cid(_cid), type(_type), portType(_portType), target(-1) {}
+};
+static_assert(sizeof(QueuedCommand) <= 24, "queued commands should stay compact");
+
+// bounded mpmc ring (vyukov) of QueuedCommands, allocated once
+struct CommandRing {
+  CommandRing(std::size_t _size);
+
+  bool push(const QueuedCommand& command);
+  bool pop(QueuedCommand& command);
+  // pops the next command only if it is of `type`
+  bool popIf(CommandType type, QueuedCommand& command);
+  bool empty() const;
+
+private:
+  bool popMatching(bool any, CommandType type, QueuedCommand& command);
+
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    QueuedCommand command;
+  };
+  std::unique_ptr<Cell[]> cells;
+  std::size_t mask;
+  std::atomic<std::size_t> enqueuePosition{0};
+  std::atomic<std::size_t> dequeuePosition{0};
+};
+
+// any thread may push, and nothing locks or allocates after construction
+// until the bulk ring fills up. the queue worker is the only consumer
+// besides `clear`.
+struct CommandQueue {
+  struct Stats {
+    uint64_t dropped;
+    uint64_t deduplicated;
+    uint64_t overflowed;
+  };
+
+  CommandQueue();
+
+  static CommandPriority priorityOf(CommandType type);
+
+  // false when nothing new was queued: the command was folded into
+  // one already waiting, or the interactive ring was full
+  bool push(const QueuedCommand& command);
+  bool pop(QueuedCommand& command, CommandPriority& priority);
+  // appends queued bulk commands of `type` to `commands` for as long as
+  // they're next in line, until it holds `max`. call right after `pop`
+  // returned one of them.
+  void popRun(CommandType type, std::vector<QueuedCommand>& commands, std::size_t max);
+  // priority of what `pop` would return next
+  bool peek(CommandPriority& priority) const;
+  // drops everything queued. the rings are mpmc, so it's safe to run
+  // alongside the worker, and a command pushed meanwhile may or may not
+  // survive it.
+  void clear();
+
+  bool empty() const;
+  Stats getStats() const;
+
+private:
+  CommandRing interactive{INTERACTIVE_COMMAND_RING_SIZE};
+  CommandRing bulk{BULK_COMMAND_RING_SIZE};
+
+  // bulk that didn't fit the ring. once anything is here, later bulk
+  // queues behind it so syncs keep their order.
+  std::mutex overflowMutex;
+  std::deque<QueuedCommand> overflow;
+  std::atomic<bool> hasOverflow{false};
+  void pushOverflow(const QueuedCommand& command);
+  // pops the oldest overflowed command, only if it is of `type` unless `any`
+  bool popOverflow(bool any, CommandType type, QueuedCommand& command);
+
+  // light updates are latest-wins: a frame that hasn't been sent yet
+  // is simply replaced by the newer one
+  std::atomic<bool> lightsPending{false};
+
+  // a queued param/port sync already sends whatever the latest state is
+  // when it runs, so later requests for the same target are dropped.
+  //
+  // a target's slot is pending while its sync is queued and free again
+  // once it's popped, a free slot keeps its target until another one
+  // reuses it. slots are only ever empty before first use, so a probe
+  // stops there. a target that finds no slot just isn't deduplicated,
+  // and two pushes racing for the same target may both be queued.
+  struct PendingTarget {
+    // version << 2 | status. the version moves on every claim, so a
+    // reader can tell the target changed while it was reading it.
+    std::atomic<uint32_t> state;
+    std::atomic<int64_t> pid;
+    std::atomic<int> cid;
+    std::atomic<int> type;
+  };
+  std::unique_ptr<PendingTarget[]> pendingTargets;
+  // returns the slot now pending for the command's target, -1 if it
+  // already was (`duplicate`) or there's no room
+  int claimTarget(const QueuedCommand& command, bool& duplicate);
+  void releaseTarget(int index);
+
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> deduplicated{0};
+  std::atomic<uint64_t> overflowed{0};
+};
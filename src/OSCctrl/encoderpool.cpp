@@ -0,0 +1,100 @@
+#include "encoderpool.hpp"
+
+#include <algorithm>
+
+int EncoderPool::resolveThreadCount(int count) {
+  // leave a core for the engine, the caller helps out anyway
+  if (count < 0) count = (int)std::thread::hardware_concurrency() - 2;
+  return std::max(0, std::min(MAX_ENCODER_THREADS, count));
+}
+
+EncoderPool::EncoderPool() : requestedThreads(resolveThreadCount(DEFAULT_ENCODER_THREADS)) {}
+
+EncoderPool::~EncoderPool() {
+  stop();
+}
+
+void EncoderPool::setThreadCount(int count) {
+  requestedThreads = resolveThreadCount(count);
+}
+
+void EncoderPool::resize(int count) {
+  if (count == threadCount && (int)threads.size() == count) return;
+
+  stop();
+
+  std::unique_lock<std::mutex> locker(mutex);
+  running = true;
+  locker.unlock();
+
+  threadCount = count;
+  for (int i = 0; i < count; i++) threads.emplace_back(&EncoderPool::work, this);
+}
+
+void EncoderPool::stop() {
+  std::unique_lock<std::mutex> locker(mutex);
+  running = false;
+  locker.unlock();
+  workCondition.notify_all();
+
+  for (std::thread& thread : threads) {
+    if (thread.joinable()) thread.join();
+  }
+  threads.clear();
+  threadCount = 0;
+}
+
+void EncoderPool::begin(int count, const Job& _job) {
+  resize(requestedThreads);
+
+  std::unique_lock<std::mutex> locker(mutex);
+  job = &_job;
+  jobCount = count;
+  nextJob = 0;
+  doneCount = 0;
+  done.assign(count, 0);
+  locker.unlock();
+
+  workCondition.notify_all();
+}
+
+// with the lock held, claims and runs the next job unlocked
+bool EncoderPool::runNext(std::unique_lock<std::mutex>& locker) {
+  if (nextJob >= jobCount) return false;
+
+  int index = nextJob++;
+  const Job* current = job;
+  locker.unlock();
+
+  (*current)(index);
+
+  locker.lock();
+  done[index] = 1;
+  ++doneCount;
+  doneCondition.notify_all();
+  return true;
+}
+
+void EncoderPool::wait(int index) {
+  std::unique_lock<std::mutex> locker(mutex);
+  while (!done[index]) {
+    if (!runNext(locker)) doneCondition.wait(locker);
+  }
+}
+
+void EncoderPool::end() {
+  std::unique_lock<std::mutex> locker(mutex);
+  while (doneCount < jobCount) {
+    if (!runNext(locker)) doneCondition.wait(locker);
+  }
+  job = nullptr;
+  jobCount = 0;
+  nextJob = 0;
+}
+
+void EncoderPool::work() {
+  std::unique_lock<std::mutex> locker(mutex);
+  while (running) {
+    if (!runNext(locker)) workCondition.wait(locker);
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// -1 picks from the core count, 0 encodes on the calling thread only
+#define DEFAULT_ENCODER_THREADS -1
+#define MAX_ENCODER_THREADS 8
+// how many queued module syncs are taken per pool thread at once
+#define ENCODER_JOBS_PER_THREAD 4
+
+// a few threads that run numbered jobs for one caller at a time.
+//
+// the caller hands over `count` jobs with `begin`, then `wait`s on them
+// in order and uses each result as soon as it's ready, while the rest are
+// still running. a caller that would otherwise block runs the next
+// unclaimed job itself, so it never sits idle behind the pool.
+struct EncoderPool {
+  typedef std::function<void(int)> Job;
+
+  EncoderPool();
+  ~EncoderPool();
+
+  // takes effect at the next `begin`
+  void setThreadCount(int count);
+  int getThreadCount() const { return requestedThreads; }
+
+  // `job` must stay valid until `end`
+  void begin(int count, const Job& job);
+  void wait(int index);
+  void end();
+
+private:
+  std::vector<std::thread> threads;
+  std::atomic<int> requestedThreads;
+  int threadCount{0};
+
+  std::mutex mutex;
+  std::condition_variable workCondition;
+  std::condition_variable doneCondition;
+  bool running{true};
+
+  const Job* job{nullptr};
+  int jobCount{0};
+  int nextJob{0};
+  int doneCount{0};
+  std::vector<char> done;
+
+  static int resolveThreadCount(int count);
+  void resize(int count);
+  void stop();
+  bool runNext(std::unique_lock<std::mutex>& locker);
+  void work();
+};
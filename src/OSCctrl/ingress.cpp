@@ -0,0 +1,136 @@
+#include "ingress.hpp"
+
+bool IngressCommand::coalesces() const {
+  return type == IngressType::UpdateMenuItemQuantity || type == IngressType::DiffModule;
+}
+
+bool IngressCommand::sameTarget(const IngressCommand& other) const {
+  if (type != other.type) return false;
+
+  switch (type) {
+    case IngressType::UpdateMenuItemQuantity:
+      return menuItem.moduleId == other.menuItem.moduleId
+        && menuItem.menuId == other.menuItem.menuId
+        && menuItem.itemIndex == other.menuItem.itemIndex;
+    case IngressType::DiffModule:
+      return target.id == other.target.id;
+    default:
+      return false;
+  }
+}
+
+IngressQueue::IngressQueue() : nodes(new Node[INGRESS_QUEUE_SIZE]) {
+  drained.reserve(INGRESS_QUEUE_SIZE);
+  for (uint32_t i = 0; i < INGRESS_QUEUE_SIZE; i++) {
+    nodes[i].index = i;
+    returnFree(&nodes[i]);
+  }
+}
+
+IngressQueue::Node* IngressQueue::takeFree() {
+  uint64_t current = freeHead.load(std::memory_order_acquire);
+  uint64_t next;
+  Node* node;
+  do {
+    uint32_t top = (uint32_t)current;
+    if (top == 0) return nullptr;
+
+    node = &nodes[top - 1];
+    next = ((current >> 32) + 1) << 32 | node->next.load(std::memory_order_relaxed);
+  } while (!freeHead.compare_exchange_weak(current, next, std::memory_order_acquire, std::memory_order_acquire));
+
+  return node;
+}
+
+void IngressQueue::returnFree(Node* node) {
+  uint64_t current = freeHead.load(std::memory_order_relaxed);
+  uint64_t next;
+  do {
+    node->next.store((uint32_t)current, std::memory_order_relaxed);
+    next = (current & 0xffffffff00000000ull) | (node->index + 1);
+  } while (!freeHead.compare_exchange_weak(current, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool IngressQueue::push(const IngressCommand& command) {
+  Node* node = takeFree();
+  if (!node) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  node->command = command;
+
+  uint32_t current = pendingHead.load(std::memory_order_relaxed);
+  do {
+    node->next.store(current, std::memory_order_relaxed);
+  } while (!pendingHead.compare_exchange_weak(current, node->index + 1, std::memory_order_release, std::memory_order_relaxed));
+
+  pushed.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+void IngressQueue::pushReliable(const IngressCommand& command) {
+  if (push(command)) return;
+
+  std::lock_guard<std::mutex> lock(overflowMutex);
+  overflow.push_back(command);
+  hasOverflow.store(true, std::memory_order_release);
+  overflowed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void IngressQueue::drain(std::vector<IngressCommand>& commands) {
+  commands.clear();
+  drainPending(commands);
+
+  if (!hasOverflow.load(std::memory_order_acquire)) return;
+
+  std::lock_guard<std::mutex> lock(overflowMutex);
+  commands.insert(commands.end(), overflow.begin(), overflow.end());
+  overflow.clear();
+  hasOverflow.store(false, std::memory_order_relaxed);
+}
+
+void IngressQueue::drainPending(std::vector<IngressCommand>& commands) {
+  uint32_t top = pendingHead.exchange(0, std::memory_order_acquire);
+  if (top == 0) return;
+
+  // the stack is newest first
+  drained.clear();
+  while (top != 0) {
+    Node* node = &nodes[top - 1];
+    drained.push_back(node);
+    top = node->next.load(std::memory_order_relaxed);
+  }
+
+  // walking newest first, the first of each target seen is the one kept
+  uint64_t collapsed = 0;
+  for (std::size_t i = 0; i < drained.size(); i++) {
+    IngressCommand& command = drained[i]->command;
+    if (!command.coalesces()) continue;
+
+    for (std::size_t j = 0; j < i; j++) {
+      if (drained[j] && drained[j]->command.sameTarget(command)) {
+        returnFree(drained[i]);
+        drained[i] = nullptr;
+        ++collapsed;
+        break;
+      }
+    }
+  }
+  if (collapsed > 0) coalesced.fetch_add(collapsed, std::memory_order_relaxed);
+
+  for (std::size_t i = drained.size(); i-- > 0;) {
+    if (!drained[i]) continue;
+    commands.push_back(drained[i]->command);
+    returnFree(drained[i]);
+  }
+}
+
+IngressQueue::Stats IngressQueue::getStats() const {
+  Stats stats;
+  stats.pushed = pushed.load(std::memory_order_relaxed);
+  stats.dropped = dropped.load(std::memory_order_relaxed);
+  stats.coalesced = coalesced.load(std::memory_order_relaxed);
+  stats.overflowed = overflowed.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// must fit in 32 bits of node index
+#define INGRESS_QUEUE_SIZE 1024
+// slugs and param id patterns, longer ones are refused
+#define INGRESS_STRING_SIZE 64
+
+enum IngressType {
+  CreateCable,
+  DestroyCable,
+  CreateModule,
+  DestroyModule,
+  ArrangeModules,
+  DiffModule,
+  GetMenu,
+  ClickMenuItem,
+  UpdateMenuItemQuantity,
+  UpdateParamPattern,
+  ResetParamPattern,
+  ModuleSynced,
+  CableSynced,
+  INGRESS_TYPE_COUNT
+};
+
+// one request from the client for the UI thread, a tagged union so it
+// can sit in a preallocated node
+struct IngressCommand {
+  IngressType type;
+
+  union {
+    struct {
+      int64_t inputModuleId, outputModuleId;
+      int inputPortId, outputPortId;
+      float r, g, b;
+    } cable;
+
+    // DestroyCable, DestroyModule, DiffModule, ModuleSynced, CableSynced
+    struct {
+      int64_t id;
+    } target;
+
+    struct {
+      char pluginSlug[INGRESS_STRING_SIZE];
+      char moduleSlug[INGRESS_STRING_SIZE];
+      int returnId;
+    } module;
+
+    struct {
+      int64_t leftModuleId, rightModuleId;
+      bool attach;
+    } arrange;
+
+    struct {
+      int64_t moduleId;
+      int menuId, parentMenuId, parentItemIndex;
+    } menu;
+
+    // ClickMenuItem, UpdateMenuItemQuantity
+    struct {
+      int64_t moduleId;
+      int menuId, itemIndex;
+      float value;
+    } menuItem;
+
+    // UpdateParamPattern, ResetParamPattern
+    struct {
+      char modulePattern[INGRESS_STRING_SIZE];
+      char paramPattern[INGRESS_STRING_SIZE];
+      float value;
+    } param;
+  };
+
+  IngressCommand() {}
+  IngressCommand(IngressType _type) : type(_type) {}
+
+  // commands of a coalescing type with equal keys replace each other,
+  // only the latest pushed before a drain survives
+  bool coalesces() const;
+  bool sameTarget(const IngressCommand& other) const;
+};
+
+// bounded multi-producer, single-consumer queue of IngressCommands.
+//
+// producers take a node from a fixed free list and push it onto a
+// pending stack, both lock-free. the consumer takes the whole pending
+// stack with one exchange, copies the commands out oldest first, and
+// returns the nodes. when the free list is empty the new command is
+// dropped and counted, the producer never waits.
+//
+// commands that mustn't be lost (acks the client won't resend) can be
+// pushed with pushReliable instead, which falls back to a locked
+// overflow list when the free list is empty. overflowed commands are
+// drained after everything else.
+struct IngressQueue {
+  struct Stats {
+    uint64_t pushed;
+    uint64_t dropped;
+    uint64_t coalesced;
+    uint64_t overflowed;
+  };
+
+  IngressQueue();
+
+  bool push(const IngressCommand& command);
+  void pushReliable(const IngressCommand& command);
+
+  // consumer only. replaces `commands` with everything pushed since the
+  // last drain, oldest first, with coalescing commands collapsed onto
+  // the position of their latest
+  void drain(std::vector<IngressCommand>& commands);
+
+  Stats getStats() const;
+
+private:
+  struct Node {
+    IngressCommand command;
+    uint32_t index;
+    std::atomic<uint32_t> next{0};
+  };
+
+  std::unique_ptr<Node[]> nodes;
+
+  // index + 1 of the top node, 0 when empty. the free list head carries
+  // a pop counter in the high 32 bits against ABA
+  std::atomic<uint64_t> freeHead{0};
+  std::atomic<uint32_t> pendingHead{0};
+
+  std::atomic<uint64_t> pushed{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<uint64_t> coalesced{0};
+  std::atomic<uint64_t> overflowed{0};
+
+  std::mutex overflowMutex;
+  std::vector<IngressCommand> overflow;
+  std::atomic<bool> hasOverflow{false};
+
+  std::vector<Node*> drained;
+
+  Node* takeFree();
+  void returnFree(Node* node);
+  void drainPending(std::vector<IngressCommand>& commands);
+};
@@ -0,0 +1,88 @@
+#include "interest.hpp"
+
+#include <algorithm>
+
+Interest::Interest() : published(std::make_shared<const Tiers>()) {}
+
+int Interest::clampTier(int tier) {
+  return std::min(std::max(tier, 0), INTEREST_TIER_COUNT - 1);
+}
+
+void Interest::publish() {
+  std::atomic_store(&published, std::shared_ptr<const Tiers>(new Tiers(tiers)));
+}
+
+// once the set empties everything is back in view, but only the modules
+// that missed updates need catching up
+void Interest::arriveAll(std::vector<int64_t>& arrived) {
+  arrived.insert(arrived.end(), missed.begin(), missed.end());
+}
+
+int Interest::tierOf(int64_t moduleId) const {
+  std::shared_ptr<const Tiers> snapshot = std::atomic_load(&published);
+  if (snapshot->empty()) return InterestTier::Focused;
+
+  Tiers::const_iterator it = snapshot->find(moduleId);
+  return it == snapshot->end() ? -1 : it->second;
+}
+
+void Interest::subscribe(int64_t moduleId, int tier, std::vector<int64_t>& arrived) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // everything was in view before the first subscription
+  bool wasWanted = tiers.empty() || tiers.count(moduleId) > 0;
+  tiers[moduleId] = clampTier(tier);
+  publish();
+
+  if (!wasWanted) arrived.push_back(moduleId);
+}
+
+void Interest::unsubscribe(int64_t moduleId, std::vector<int64_t>& arrived) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (tiers.erase(moduleId) == 0) return;
+
+  publish();
+  if (tiers.empty()) arriveAll(arrived);
+}
+
+void Interest::set(const std::vector<std::pair<int64_t, int>>& modules, std::vector<int64_t>& arrived) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  bool wasActive = !tiers.empty();
+  Tiers next;
+  for (const std::pair<int64_t, int>& module : modules) {
+    bool listed = next.count(module.first) > 0;
+    next[module.first] = clampTier(module.second);
+    if (!listed && wasActive && tiers.count(module.first) == 0) arrived.push_back(module.first);
+  }
+
+  tiers.swap(next);
+  publish();
+  if (wasActive && tiers.empty()) arriveAll(arrived);
+}
+
+void Interest::forget(int64_t moduleId, std::vector<int64_t>& arrived) {
+  std::lock_guard<std::mutex> lock(mutex);
+  missed.erase(moduleId);
+  if (tiers.erase(moduleId) == 0) return;
+
+  publish();
+  if (tiers.empty()) arriveAll(arrived);
+}
+
+void Interest::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  tiers.clear();
+  missed.clear();
+  publish();
+}
+
+void Interest::miss(int64_t moduleId) {
+  std::lock_guard<std::mutex> lock(mutex);
+  missed.insert(moduleId);
+}
+
+bool Interest::takeMissed(int64_t moduleId) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return missed.erase(moduleId) > 0;
+}
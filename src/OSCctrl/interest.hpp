@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// lower is more interesting, past the last tier counts as the last tier
+enum InterestTier {
+  Focused,
+  Visible,
+  Peripheral,
+  INTEREST_TIER_COUNT
+};
+
+// which modules the client wants streamed, and how eagerly. while the
+// client is subscribed to nothing every module is streamed as Focused,
+// otherwise only what it subscribed to is.
+//
+// updates skipped for a module that's out of view are remembered, so it
+// can be caught up when it comes back.
+//
+// changes are made under a lock and published as an immutable copy of
+// the set, which tierOf reads without locking.
+struct Interest {
+  Interest();
+
+  // -1 when the module isn't of interest
+  int tierOf(int64_t moduleId) const;
+  bool wants(int64_t moduleId) const { return tierOf(moduleId) >= 0; }
+
+  // each adds the modules that just came into view to `arrived`
+  void subscribe(int64_t moduleId, int tier, std::vector<int64_t>& arrived);
+  void unsubscribe(int64_t moduleId, std::vector<int64_t>& arrived);
+  // replaces the whole set
+  void set(const std::vector<std::pair<int64_t, int>>& modules, std::vector<int64_t>& arrived);
+
+  // the module is gone
+  void forget(int64_t moduleId, std::vector<int64_t>& arrived);
+  // back to streaming everything
+  void clear();
+
+  // an update for an out of view module was skipped
+  void miss(int64_t moduleId);
+  // true once per run of misses
+  bool takeMissed(int64_t moduleId);
+
+private:
+  typedef std::unordered_map<int64_t, int> Tiers;
+
+  std::mutex mutex;
+  Tiers tiers;
+  std::unordered_set<int64_t> missed;
+  // empty while nothing is subscribed
+  std::shared_ptr<const Tiers> published;
+
+  static int clampTier(int tier);
+  // mutex must be held
+  void publish();
+  void arriveAll(std::vector<int64_t>& arrived);
+};
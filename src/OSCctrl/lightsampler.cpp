@@ -0,0 +1,58 @@
+#include "lightsampler.hpp"
+
+#include <algorithm>
+
+// how often read copies again before giving up on a frame
+#define LIGHT_SAMPLER_READ_ATTEMPTS 4
+
+void LightSampler::setLayout(const std::vector<SampledModule>& _modules) {
+  std::lock_guard<std::mutex> lock(layoutMutex);
+
+  modules = _modules;
+  std::size_t size = 0;
+  for (const SampledModule& module : modules) size += module.lightCount;
+
+  for (int i = 0; i < 2; i++) buffers[i].assign(size, 0.f);
+  sequence.store(0, std::memory_order_release);
+}
+
+void LightSampler::sample(rack::engine::Engine* engine) {
+  std::unique_lock<std::mutex> lock(layoutMutex, std::try_to_lock);
+  if (!lock.owns_lock() || modules.empty()) return;
+
+  uint64_t begin = sequence.load(std::memory_order_relaxed) + 1;
+  sequence.store(begin, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  float* samples = buffers[(begin / 2 + 1) & 1].data();
+  for (const SampledModule& sampled : modules) {
+    // process runs under the engine's lock, modules can't be removed
+    // out from under it
+    rack::engine::Module* module = engine->getModule_NoLock(sampled.moduleId);
+    int available = module ? (int)module->lights.size() - sampled.firstLightId : 0;
+    available = rack::math::clamp(available, 0, sampled.lightCount);
+
+    for (int i = 0; i < available; i++) samples[i] = module->lights[sampled.firstLightId + i].getBrightness();
+    std::fill(samples + available, samples + sampled.lightCount, 0.f);
+    samples += sampled.lightCount;
+  }
+
+  sequence.store(begin + 1, std::memory_order_release);
+}
+
+bool LightSampler::read(std::vector<float>& brightness) {
+  for (int attempt = 0; attempt < LIGHT_SAMPLER_READ_ATTEMPTS; attempt++) {
+    uint64_t start = sequence.load(std::memory_order_acquire);
+    uint64_t complete = start / 2;
+    if (complete == 0) return false;
+
+    const std::vector<float>& buffer = buffers[complete & 1];
+    brightness.assign(buffer.begin(), buffer.end());
+
+    // the writer only touches this buffer again once it starts sample
+    // complete + 2
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) <= complete * 2 + 2) return true;
+  }
+  return false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <rack.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// `lightCount` of a module's engine lights, from `firstLightId`
+struct SampledModule {
+  int64_t moduleId;
+  int firstLightId;
+  int lightCount;
+};
+
+// copies light brightnesses straight out of Module::lights on the engine
+// thread, so lights keep moving while Rack isn't stepping (or drawing)
+// its widgets. the sampled modules' lights are laid out back to back in
+// the order they were given to setLayout.
+//
+// samples are double buffered behind a seqlock: the engine thread writes
+// the buffer readers aren't on and never waits, a reader retries in the
+// rare case the writer came back around to the buffer it was copying.
+struct LightSampler {
+  // not the engine thread, and not concurrently with read
+  void setLayout(const std::vector<SampledModule>& modules);
+  void clear() { setLayout(std::vector<SampledModule>()); }
+
+  // engine thread, from a module's process. skips the frame rather than
+  // wait on a layout change.
+  void sample(rack::engine::Engine* engine);
+
+  // copies out the latest complete sample, false if there's nothing
+  // sampled since the layout last changed
+  bool read(std::vector<float>& brightness);
+
+private:
+  std::mutex layoutMutex;
+  std::vector<SampledModule> modules;
+
+  // odd while a sample is being written, sample n is in buffers[n & 1]
+  std::atomic<uint64_t> sequence{0};
+  std::vector<float> buffers[2];
+};
@@ -0,0 +1,319 @@
+#include "lighttable.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+void LightTable::registerModule(int64_t moduleId, const std::vector<const VCVLight*>& lights) {
+  std::unordered_map<int, const VCVLight*> byId;
+  for (const VCVLight* light : lights) byId[light->id] = light;
+
+  // indices already handed out stay where they are
+  std::vector<int> ids;
+  int every = 1;
+  std::unordered_map<int64_t, std::size_t>::iterator it = segmentIndex.find(moduleId);
+  if (it != segmentIndex.end()) {
+    const Segment& segment = segments[it->second];
+    every = segment.every;
+    ids.assign(lightIds.begin() + segment.first, lightIds.begin() + segment.first + segment.count);
+    removeSegment(it->second);
+  }
+  std::unordered_set<int> known(ids.begin(), ids.end());
+  for (const VCVLight* light : lights) {
+    if (known.insert(light->id).second) ids.push_back(light->id);
+  }
+  if (ids.size() > LIGHT_FRAME_MAX_LIGHTS) {
+    WARN("too many lights on module %lld, %lld won't be in light frames", moduleId, ids.size() - LIGHT_FRAME_MAX_LIGHTS);
+  }
+
+  std::size_t first = lightIds.size();
+  for (int c = 0; c < 4; c++) {
+    current[c].resize(first);
+    sent[c].resize(first);
+  }
+  widgets.resize(first);
+  sources.resize(first);
+  polls.resize(first);
+
+  for (int id : ids) {
+    std::unordered_map<int, const VCVLight*>::iterator light = byId.find(id);
+    NVGcolor color = light == byId.end() ? nvgRGBAf(0, 0, 0, 0) : light->second->color;
+
+    lightIds.push_back(id);
+    widgets.push_back(light == byId.end() ? nullptr : light->second->widget);
+    sources.push_back(light == byId.end() ? Source() : sourceOf(light->second));
+    polls.push_back(Poll());
+    polls.back().sent = frame;
+    current[0].push_back(color.r);
+    current[1].push_back(color.g);
+    current[2].push_back(color.b);
+    current[3].push_back(color.a);
+    sent[0].push_back(color.r);
+    sent[1].push_back(color.g);
+    sent[2].push_back(color.b);
+    sent[3].push_back(color.a);
+  }
+
+  segmentIndex[moduleId] = segments.size();
+  segments.push_back(Segment{moduleId, first, ids.size(), every, false});
+  pad();
+  layoutSamples();
+}
+
+void LightTable::eraseModule(int64_t moduleId) {
+  std::unordered_map<int64_t, std::size_t>::iterator it = segmentIndex.find(moduleId);
+  if (it == segmentIndex.end()) return;
+  removeSegment(it->second);
+  pad();
+  layoutSamples();
+}
+
+void LightTable::clear() {
+  segments.clear();
+  segmentIndex.clear();
+  lightIds.clear();
+  widgets.clear();
+  sources.clear();
+  sampledModules.clear();
+  polls.clear();
+  for (int c = 0; c < 4; c++) {
+    current[c].clear();
+    sent[c].clear();
+  }
+  dirty.clear();
+  polled.clear();
+}
+
+// shifts later segments down over it, leaves the arrays unpadded
+void LightTable::removeSegment(std::size_t position) {
+  Segment segment = segments[position];
+  std::size_t first = segment.first, last = segment.first + segment.count;
+
+  lightIds.erase(lightIds.begin() + first, lightIds.begin() + last);
+  widgets.erase(widgets.begin() + first, widgets.begin() + last);
+  sources.erase(sources.begin() + first, sources.begin() + last);
+  polls.erase(polls.begin() + first, polls.begin() + last);
+  for (int c = 0; c < 4; c++) {
+    current[c].erase(current[c].begin() + first, current[c].begin() + last);
+    sent[c].erase(sent[c].begin() + first, sent[c].begin() + last);
+  }
+
+  segments.erase(segments.begin() + position);
+  segmentIndex.erase(segment.moduleId);
+  for (std::size_t i = position; i < segments.size(); i++) {
+    segments[i].first -= segment.count;
+    segmentIndex[segments[i].moduleId] = i;
+  }
+}
+
+// padding lights have no widget and match what was sent, so they never
+// come up dirty
+void LightTable::pad() {
+  std::size_t padded = (lightIds.size() + LIGHT_TABLE_LANES - 1) / LIGHT_TABLE_LANES * LIGHT_TABLE_LANES;
+
+  widgets.resize(lightIds.size());
+  widgets.resize(padded, nullptr);
+  sources.resize(padded);
+  polls.resize(lightIds.size());
+  polls.resize(padded);
+  for (int c = 0; c < 4; c++) {
+    current[c].resize(lightIds.size());
+    current[c].resize(padded, 0.f);
+    sent[c].resize(lightIds.size());
+    sent[c].resize(padded, 0.f);
+  }
+  dirty.assign((padded + 63) / 64, 0);
+  polled.assign((padded + 63) / 64, 0);
+}
+
+LightTable::Source LightTable::sourceOf(const VCVLight* light) {
+  Source source;
+
+  rack::app::ModuleLightWidget* widget = dynamic_cast<rack::app::ModuleLightWidget*>(light->widget);
+  if (!widget || !widget->module || widget->firstLightId < 0) return source;
+
+  source.moduleId = widget->module->id;
+  source.firstLightId = widget->firstLightId;
+  source.baseColors = widget->baseColors;
+  return source;
+}
+
+// as ModuleLightWidget::step then MultiLightWidget::setBrightnesses
+NVGcolor LightTable::mix(const Source& source, const float* brightness) {
+  NVGcolor color = nvgRGBAf(0, 0, 0, 0);
+  for (std::size_t i = 0; i < source.baseColors.size(); i++) {
+    float b = brightness[source.sample + i];
+    if (!std::isfinite(b)) b = 0.f;
+    // leds aren't linear, rack draws the square root
+    b = std::sqrt(rack::math::clamp(b, 0.f, 1.f));
+
+    NVGcolor base = source.baseColors[i];
+    base.a *= b;
+    color = rack::color::screen(color, base);
+  }
+  return rack::color::clamp(color);
+}
+
+// one run of engine lights per module, from its lowest sampled light
+// id to its highest
+void LightTable::layoutSamples() {
+  std::unordered_map<int64_t, std::pair<int, int>> ranges;
+  std::vector<int64_t> order;
+
+  for (std::size_t i = 0; i < lightIds.size(); i++) {
+    const Source& source = sources[i];
+    if (source.baseColors.empty()) continue;
+
+    int last = source.firstLightId + source.baseColors.size();
+    std::unordered_map<int64_t, std::pair<int, int>>::iterator range = ranges.find(source.moduleId);
+    if (range == ranges.end()) {
+      ranges[source.moduleId] = std::make_pair(source.firstLightId, last);
+      order.push_back(source.moduleId);
+    } else {
+      range->second.first = std::min(range->second.first, source.firstLightId);
+      range->second.second = std::max(range->second.second, last);
+    }
+  }
+
+  sampledModules.clear();
+  std::unordered_map<int64_t, std::size_t> offsets;
+  std::size_t offset = 0;
+  for (int64_t moduleId : order) {
+    const std::pair<int, int>& range = ranges[moduleId];
+    sampledModules.push_back(SampledModule{moduleId, range.first, range.second - range.first});
+    offsets[moduleId] = offset;
+    offset += range.second - range.first;
+  }
+
+  for (std::size_t i = 0; i < lightIds.size(); i++) {
+    Source& source = sources[i];
+    if (source.baseColors.empty()) continue;
+    source.sample = offsets[source.moduleId] + source.firstLightId - ranges[source.moduleId].first;
+  }
+}
+
+void LightTable::reschedule(Poll& poll, bool changed) {
+  if (changed) {
+    poll.interval = 1;
+    poll.idle = 0;
+  } else if ((poll.idle += poll.interval) >= LIGHT_IDLE_FRAMES) {
+    // never wait past the point a light would go stale
+    int longest = std::min(LIGHT_MAX_POLL_INTERVAL, maxStaleFrames);
+    poll.interval = std::min(poll.interval * 2, longest);
+    poll.idle = 0;
+  }
+  poll.next = frame + poll.interval;
+}
+
+std::size_t LightTable::detectChanges(const float* brightness) {
+  std::size_t padded = widgets.size();
+  frame++;
+
+  std::fill(polled.begin(), polled.end(), 0);
+  for (const Segment& segment : segments) {
+    if (!segment.catchUp && (!segment.every || frame % segment.every)) continue;
+
+    for (std::size_t i = segment.first; i < segment.first + segment.count; i++) {
+      if (polls[i].next > frame && !segment.catchUp) continue;
+      polled[i / 64] |= (uint64_t)1 << (i % 64);
+
+      NVGcolor color;
+      if (!sources[i].baseColors.empty()) {
+        if (!brightness) continue;
+        color = mix(sources[i], brightness);
+      } else if (widgets[i]) {
+        color = widgets[i]->color;
+      } else {
+        continue;
+      }
+      current[0][i] = color.r;
+      current[1][i] = color.g;
+      current[2][i] = color.b;
+      current[3][i] = color.a;
+    }
+  }
+
+  std::fill(dirty.begin(), dirty.end(), 0);
+  std::size_t changed = 0;
+
+  using rack::simd::float_4;
+  const float_4 threshold(changeThreshold / 255.f);
+  const float_4 zero(0.f);
+
+  for (std::size_t i = 0; i < padded; i += LIGHT_TABLE_LANES) {
+    int lanes = (polled[i / 64] >> (i % 64)) & 0xf;
+    if (!lanes) continue;
+
+    float_4 delta = rack::simd::fabs(float_4::load(&current[0][i]) - float_4::load(&sent[0][i]));
+    for (int c = 1; c < 4; c++)
+      delta = rack::simd::fmax(delta, rack::simd::fabs(float_4::load(&current[c][i]) - float_4::load(&sent[c][i])));
+
+    int over = rack::simd::movemask(delta > threshold) & lanes;
+    int below = rack::simd::movemask(delta > zero) & lanes & ~over;
+    int mask = over;
+
+    for (int lane = 0; lane < LIGHT_TABLE_LANES; lane++) {
+      if (!(lanes & (1 << lane))) continue;
+      Poll& poll = polls[i + lane];
+      if ((below & (1 << lane)) && frame - poll.sent >= (uint64_t)maxStaleFrames) mask |= 1 << lane;
+      reschedule(poll, over & (1 << lane));
+    }
+
+    if (!mask) continue;
+    dirty[i / 64] |= (uint64_t)mask << (i % 64);
+    changed += __builtin_popcount(mask);
+  }
+
+  // everything a caught up module shows, whether it changed or not
+  for (Segment& segment : segments) {
+    if (!segment.catchUp) continue;
+    segment.catchUp = false;
+
+    for (std::size_t i = segment.first; i < segment.first + segment.count; i++) {
+      uint64_t bit = (uint64_t)1 << (i % 64);
+      if (dirty[i / 64] & bit) continue;
+      if (!widgets[i] && sources[i].baseColors.empty()) continue;
+      dirty[i / 64] |= bit;
+      changed++;
+    }
+  }
+
+  return changed;
+}
+
+void LightTable::setEvery(int64_t moduleId, int frames) {
+  std::unordered_map<int64_t, std::size_t>::iterator it = segmentIndex.find(moduleId);
+  if (it != segmentIndex.end()) segments[it->second].every = std::max(frames, 0);
+}
+
+void LightTable::catchUp(int64_t moduleId) {
+  std::unordered_map<int64_t, std::size_t>::iterator it = segmentIndex.find(moduleId);
+  if (it != segmentIndex.end()) segments[it->second].catchUp = true;
+}
+
+std::size_t LightTable::nextDirty(std::size_t from, std::size_t to) const {
+  while (from < to) {
+    uint64_t word = dirty[from / 64] >> (from % 64);
+    if (word) {
+      from += __builtin_ctzll(word);
+      return from < to ? from : to;
+    }
+    from = (from / 64 + 1) * 64;
+  }
+  return to;
+}
+
+void LightTable::markSent(std::size_t index) {
+  for (int c = 0; c < 4; c++) sent[c][index] = current[c][index];
+  polls[index].sent = frame;
+  dirty[index / 64] &= ~((uint64_t)1 << (index % 64));
+}
+
+bool LightTable::getLightIds(int64_t moduleId, std::vector<int>& ids) const {
+  std::unordered_map<int64_t, std::size_t>::const_iterator it = segmentIndex.find(moduleId);
+  if (it == segmentIndex.end()) return false;
+
+  const Segment& segment = segments[it->second];
+  ids.assign(lightIds.begin() + segment.first, lightIds.begin() + segment.first + segment.count);
+  return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <rack.hpp>
+#include "../VCVStructure.hpp"
+#include "lightsampler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// lights compared per step, the flat arrays are padded to a multiple of this
+#define LIGHT_TABLE_LANES 4
+
+// in 8-bit steps, a channel has to move by more than this to be sent
+#define DEFAULT_LIGHT_CHANGE_THRESHOLD 1
+// a light that hasn't changed in this many frames is polled half as
+// often, down to once every LIGHT_MAX_POLL_INTERVAL frames
+#define LIGHT_IDLE_FRAMES 16
+#define LIGHT_MAX_POLL_INTERVAL 8
+// a change under the threshold still goes out once a light has gone
+// this many frames without being sent
+#define DEFAULT_LIGHT_MAX_STALE_FRAMES 60
+// lights a module can have in light frames. its whole index, 4 bytes a
+// light, has to fit one udp datagram
+#define LIGHT_FRAME_MAX_LIGHTS ((65507 - 64) / 4)
+
+// every registered light in one flat table, a module's lights in one
+// contiguous segment. widget pointers, ids and the current and last sent
+// color channels live in separate arrays, so finding what changed is a
+// gather of current colors followed by a 4-wide compare of current against
+// sent that sets bits in a dirty bitmap.
+//
+// a light is only sent when one of its 8-bit channels moves by more than
+// the change threshold, so flicker nobody can see stays home. lights that
+// keep still are polled less and less often, any change puts a light
+// back to being polled every frame. whatever the threshold and interval,
+// a light that's off by anything at all is sent once it's been stale for
+// max stale frames (give or take its poll interval).
+//
+// a ModuleLightWidget's color is mixed from engine light brightnesses
+// (see LightSampler) and the base colors it had when registered, the same
+// way the widget mixes them. other light widgets are read as they are.
+//
+// a light's position in its module's segment is its compact index (see
+// OscController::sendLightIndex). indices are handed out in registration
+// order and never reused while the module is registered.
+//
+// not locked, see OscController::lmutex
+struct LightTable {
+  struct Segment {
+    int64_t moduleId;
+    std::size_t first;
+    std::size_t count;
+    // polled on every nth frame, never when 0
+    int every;
+    // send every light on the next frame
+    bool catchUp;
+  };
+
+  // registers (or re-registers) a module's lights, a light keeps its
+  // compact index across re-registration
+  void registerModule(int64_t moduleId, const std::vector<const VCVLight*>& lights);
+  void eraseModule(int64_t moduleId);
+  void clear();
+
+  // a module keeps its rate when re-registered, new modules start at 1
+  void setEvery(int64_t moduleId, int frames);
+  void catchUp(int64_t moduleId);
+
+  // the engine lights to sample, laid out the way detectChanges expects
+  const std::vector<SampledModule>& getSampledModules() const { return sampledModules; }
+
+  // counts a frame, updates the color of every light that's due to be
+  // polled and marks the ones that no longer match what was last sent,
+  // returns the number marked. without `brightness` lights mixed from the
+  // engine keep their last color.
+  std::size_t detectChanges(const float* brightness);
+  // first dirty light in [from, to), `to` if there is none
+  std::size_t nextDirty(std::size_t from, std::size_t to) const;
+  void markSent(std::size_t index);
+
+  const std::vector<Segment>& getSegments() const { return segments; }
+  int getLightId(std::size_t index) const { return lightIds[index]; }
+  NVGcolor getColor(std::size_t index) const {
+    return nvgRGBAf(current[0][index], current[1][index], current[2][index], current[3][index]);
+  }
+  // false if the module isn't registered
+  bool getLightIds(int64_t moduleId, std::vector<int>& ids) const;
+  std::size_t size() const { return lightIds.size(); }
+
+  void setChangeThreshold(int steps) { changeThreshold = std::max(steps, 0); }
+  void setMaxStaleFrames(int frames) { maxStaleFrames = std::max(frames, 1); }
+
+private:
+  // where a light's color comes from, no colors means its widget
+  struct Source {
+    int64_t moduleId{-1};
+    int firstLightId{0};
+    std::vector<NVGcolor> baseColors;
+    // into the sampled brightnesses
+    std::size_t sample{0};
+  };
+
+  struct Poll {
+    uint64_t next{0};
+    uint64_t sent{0};
+    uint16_t interval{1};
+    // frames unchanged at this interval
+    uint16_t idle{0};
+  };
+
+  int changeThreshold{DEFAULT_LIGHT_CHANGE_THRESHOLD};
+  int maxStaleFrames{DEFAULT_LIGHT_MAX_STALE_FRAMES};
+  uint64_t frame{0};
+
+  std::vector<Segment> segments;
+  // module id -> position in segments
+  std::unordered_map<int64_t, std::size_t> segmentIndex;
+
+  std::vector<int> lightIds;
+  // null for lights that are gone but keep their index, and for padding
+  std::vector<rack::app::LightWidget*> widgets;
+  // r, g, b, a
+  std::vector<float> current[4];
+  std::vector<float> sent[4];
+  std::vector<uint64_t> dirty;
+  // lights polled this frame
+  std::vector<uint64_t> polled;
+  std::vector<Poll> polls;
+
+  std::vector<Source> sources;
+  std::vector<SampledModule> sampledModules;
+
+  static Source sourceOf(const VCVLight* light);
+  static NVGcolor mix(const Source& source, const float* brightness);
+  void layoutSamples();
+  void reschedule(Poll& poll, bool changed);
+  void removeSegment(std::size_t position);
+  void pad();
+};
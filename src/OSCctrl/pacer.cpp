@@ -0,0 +1,84 @@
+#include "pacer.hpp"
+
+#include <algorithm>
+
+// latency above (base * factor + slack) counts as queueing in the client
+#define LATENCY_FACTOR 4.0
+#define LATENCY_SLACK 0.02
+
+Pacer::Pacer(double _maxRate, double _burst) {
+  configure(_maxRate, _burst);
+}
+
+void Pacer::configure(double _maxRate, double _burst) {
+  std::lock_guard<std::mutex> lock(pmutex);
+  maxRate = std::max(_maxRate, (double)MIN_PACER_RATE);
+  rate = maxRate;
+  burst = _burst;
+  tokens = burst;
+  lastRefill = Clock::now();
+}
+
+void Pacer::refill() {
+  Clock::time_point now = Clock::now();
+  double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+  lastRefill = now;
+  tokens = std::min(burst, tokens + elapsed * rate);
+}
+
+void Pacer::consume(std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(pmutex);
+  refill();
+  tokens -= bytes;
+}
+
+Pacer::Clock::duration Pacer::bulkDelay() {
+  std::lock_guard<std::mutex> lock(pmutex);
+  refill();
+  if (tokens >= 0) return Clock::duration::zero();
+
+  return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-tokens / rate));
+}
+
+bool Pacer::allowLightFrame() {
+  std::lock_guard<std::mutex> lock(pmutex);
+  refill();
+
+  unsigned int divider = 1;
+  if (tokens < 0) {
+    divider = 4;
+  } else if (tokens < burst / 2) {
+    divider = 2;
+  }
+
+  return ++lightFrame % divider == 0;
+}
+
+void Pacer::onAck(Clock::duration latency) {
+  double seconds = std::chrono::duration<double>(latency).count();
+
+  std::lock_guard<std::mutex> lock(pmutex);
+  if (baseLatency < 0 || seconds < baseLatency) baseLatency = seconds;
+
+  if (seconds > baseLatency * LATENCY_FACTOR + LATENCY_SLACK) {
+    rate = std::max((double)MIN_PACER_RATE, rate * 0.9);
+  } else {
+    rate = std::min(maxRate, rate + maxRate / 50);
+  }
+}
+
+void Pacer::onLoss() {
+  std::lock_guard<std::mutex> lock(pmutex);
+  rate = std::max((double)MIN_PACER_RATE, rate * 0.5);
+}
+
+double Pacer::getRate() {
+  std::lock_guard<std::mutex> lock(pmutex);
+  return rate;
+}
+
+double Pacer::getTokens() {
+  std::lock_guard<std::mutex> lock(pmutex);
+  refill();
+  return tokens;
+}
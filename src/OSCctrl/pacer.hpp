@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+#define DEFAULT_PACER_RATE (1024 * 1024 * 16)
+#define DEFAULT_PACER_BURST (1024 * 256)
+// adaptation never takes the rate below this
+#define MIN_PACER_RATE (1024 * 256)
+
+// token bucket in front of everything we send.
+//
+// every datagram is charged, but only bulk syncs ever wait for tokens.
+// interactive echoes may push the bucket into debt, which bulk then pays
+// back. as the bucket drains light frames are thinned out first, and
+// bulk is only deferred once it's empty.
+//
+// the rate starts at the configured maximum and adapts from module sync
+// acks: it backs off when a sync has to be resent or when ack latency
+// climbs well above the best seen, and creeps back up otherwise.
+struct Pacer {
+  typedef std::chrono::steady_clock Clock;
+
+  Pacer(double _maxRate = DEFAULT_PACER_RATE, double _burst = DEFAULT_PACER_BURST);
+
+  // bytes per second and bucket size in bytes
+  void configure(double _maxRate, double _burst);
+
+  void consume(std::size_t bytes);
+
+  // how long bulk should hold off, zero when it can go now
+  Clock::duration bulkDelay();
+  // thins light frames out while the bucket is low, call once per frame
+  bool allowLightFrame();
+
+  void onAck(Clock::duration latency);
+  void onLoss();
+
+  double getRate();
+  double getTokens();
+
+private:
+  std::mutex pmutex;
+
+  double maxRate;
+  double rate;
+  double burst;
+  double tokens;
+  Clock::time_point lastRefill;
+
+  // best ack latency seen, in seconds. < 0 until the first ack
+  double baseLatency{-1.0};
+  unsigned int lightFrame{0};
+
+  void refill();
+};
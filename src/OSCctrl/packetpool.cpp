@@ -0,0 +1,93 @@
+#include "packetpool.hpp"
+
+PacketPool::PacketPool(std::size_t _count, std::size_t _bufferSize)
+  : count(_count),
+    bufferSize(_bufferSize),
+    buffers(new PacketBuffer[_count]),
+    storage(new char[_count * _bufferSize]) {
+  for (std::size_t i = 0; i < count; i++) {
+    PacketBuffer& packet = buffers[i];
+    packet.data = storage.get() + i * bufferSize;
+    packet.capacity = bufferSize;
+    packet.pool = this;
+    packet.index = i;
+    push(&packet);
+  }
+}
+
+PacketPool::~PacketPool() {}
+
+void PacketPool::push(PacketBuffer* packet) {
+  uint64_t current = head.load(std::memory_order_relaxed);
+  uint64_t next;
+  do {
+    packet->next.store((uint32_t)current, std::memory_order_relaxed);
+    next = (current & 0xffffffff00000000ull) | (uint64_t)(packet->index + 1);
+  } while (!head.compare_exchange_weak(current, next, std::memory_order_release, std::memory_order_relaxed));
+
+  available.fetch_add(1, std::memory_order_relaxed);
+}
+
+PacketBuffer* PacketPool::pop() {
+  uint64_t current = head.load(std::memory_order_acquire);
+  uint64_t next;
+  PacketBuffer* packet;
+  do {
+    uint32_t top = (uint32_t)current;
+    if (top == 0) return nullptr;
+
+    packet = &buffers[top - 1];
+    uint64_t tag = (current >> 32) + 1;
+    next = (tag << 32) | packet->next.load(std::memory_order_relaxed);
+  } while (!head.compare_exchange_weak(current, next, std::memory_order_acquire, std::memory_order_acquire));
+
+  available.fetch_sub(1, std::memory_order_relaxed);
+  return packet;
+}
+
+PacketBuffer* PacketPool::acquire() {
+  PacketBuffer* packet = pop();
+
+  if (!packet) {
+    packet = new PacketBuffer;
+    packet->data = new char[bufferSize];
+    packet->capacity = bufferSize;
+    packet->pool = this;
+    packet->pooled = false;
+    overflowed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  packet->size = 0;
+  acquired.fetch_add(1, std::memory_order_relaxed);
+
+  std::size_t used = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+  std::size_t peak = peakInUse.load(std::memory_order_relaxed);
+  while (used > peak && !peakInUse.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {}
+
+  return packet;
+}
+
+void PacketPool::release(PacketBuffer* packet) {
+  if (!packet) return;
+  inUse.fetch_sub(1, std::memory_order_relaxed);
+
+  if (!packet->pooled) {
+    delete[] packet->data;
+    delete packet;
+    return;
+  }
+
+  push(packet);
+}
+
+PacketPool::Stats PacketPool::getStats() const {
+  Stats stats;
+  stats.capacity = count;
+  stats.available = available.load(std::memory_order_relaxed);
+  stats.inUse = inUse.load(std::memory_order_relaxed);
+  stats.peakInUse = peakInUse.load(std::memory_order_relaxed);
+  stats.acquired = acquired.load(std::memory_order_relaxed);
+  stats.overflowed = overflowed.load(std::memory_order_relaxed);
+  return stats;
+}
+
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#define DEFAULT_PACKET_POOL_SIZE 32
+#define PACKET_BUFFER_SIZE (1024 * 128)
+
+struct PacketPool;
+
+// one outbound datagram. whoever holds the pointer owns the buffer:
+// a producer acquires it, encodes into `data`, sets `size` and hands it
+// to the Transmitter, which releases it once it's on the wire.
+struct PacketBuffer {
+  char* data{nullptr};
+  std::size_t capacity{0};
+  std::size_t size{0};
+
+  PacketPool* pool{nullptr};
+  // false for the overflow buffers handed out when the pool is empty
+  bool pooled{true};
+
+  uint32_t index{0};
+  std::atomic<uint32_t> next{0};
+};
+
+// fixed set of preallocated packet buffers shared by every thread that
+// sends. acquire/release are a lock-free (treiber) stack push/pop, the
+// head carries a tag alongside the index so a buffer recycled between
+// another thread's load and compare-exchange can't corrupt the list.
+//
+// never fails: once the pool is empty, acquire falls back to a heap
+// buffer which is deleted again on release and counted in the stats.
+struct PacketPool {
+  struct Stats {
+    std::size_t capacity;
+    std::size_t available;
+    std::size_t inUse;
+    std::size_t peakInUse;
+    uint64_t acquired;
+    uint64_t overflowed;
+  };
+
+  PacketPool(std::size_t count = DEFAULT_PACKET_POOL_SIZE, std::size_t bufferSize = PACKET_BUFFER_SIZE);
+  ~PacketPool();
+
+  PacketBuffer* acquire();
+  void release(PacketBuffer* packet);
+
+  std::size_t getCapacity() const { return count; }
+  std::size_t getAvailable() const { return available.load(std::memory_order_relaxed); }
+  Stats getStats() const;
+
+private:
+  std::size_t count;
+  std::size_t bufferSize;
+  std::unique_ptr<PacketBuffer[]> buffers;
+  std::unique_ptr<char[]> storage;
+
+  // low 32 bits are index + 1 of the top buffer (0 when empty),
+  // high 32 bits are bumped on every successful pop
+  std::atomic<uint64_t> head{0};
+
+  std::atomic<std::size_t> available{0};
+  std::atomic<std::size_t> inUse{0};
+  std::atomic<std::size_t> peakInUse{0};
+  std::atomic<uint64_t> acquired{0};
+  std::atomic<uint64_t> overflowed{0};
+
+  void push(PacketBuffer* packet);
+  PacketBuffer* pop();
+};
+
+// releases an acquired packet unless it's been handed on, so an encode
+// that throws (osc::OutOfBufferMemoryException, say) can't leak it
+struct PacketGuard {
+  explicit PacketGuard(PacketBuffer* _packet = nullptr) : packet(_packet) {}
+  ~PacketGuard() { reset(); }
+
+  PacketGuard(const PacketGuard&) = delete;
+  PacketGuard& operator=(const PacketGuard&) = delete;
+
+  PacketBuffer* get() const { return packet; }
+  PacketBuffer* operator->() const { return packet; }
+
+  // gives up ownership
+  PacketBuffer* release() {
+    PacketBuffer* released = packet;
+    packet = nullptr;
+    return released;
+  }
+
+  void reset(PacketBuffer* _packet = nullptr) {
+    if (packet) packet->pool->release(packet);
+    packet = _packet;
+  }
+
+private:
+  PacketBuffer* packet;
+};
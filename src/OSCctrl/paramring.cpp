@@ -0,0 +1,22 @@
+#include "paramring.hpp"
+
+bool ParamRing::push(const ParamWrite& write) {
+  std::size_t at = tail.load(std::memory_order_relaxed);
+  if (at - head.load(std::memory_order_acquire) >= PARAM_RING_SIZE) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  slots[at & (PARAM_RING_SIZE - 1)] = write;
+  tail.store(at + 1, std::memory_order_release);
+  return true;
+}
+
+bool ParamRing::pop(ParamWrite& write) {
+  std::size_t at = head.load(std::memory_order_relaxed);
+  if (at == tail.load(std::memory_order_acquire)) return false;
+
+  write = slots[at & (PARAM_RING_SIZE - 1)];
+  head.store(at + 1, std::memory_order_release);
+  return true;
+}
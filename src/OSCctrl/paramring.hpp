@@ -0,0 +1,37 @@
+#pragma once
+#include "paramtable.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// must be a power of two
+#define PARAM_RING_SIZE 4096
+
+// a param value on its way to or from the audio thread
+struct ParamWrite {
+  ParamUpdate update;
+  // steady clock nanoseconds when it was queued
+  int64_t queued;
+};
+
+// one producer thread, one consumer thread, fixed storage. push and pop
+// are wait-free: they never lock, allocate or retry. a full ring drops
+// (and counts) the newest write.
+struct ParamRing {
+  bool push(const ParamWrite& write);
+  bool pop(ParamWrite& write);
+
+  bool empty() const {
+    return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_relaxed);
+  }
+  uint64_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  ParamWrite slots[PARAM_RING_SIZE];
+  // next to pop, only moved by the consumer
+  std::atomic<std::size_t> head{0};
+  // next to push, only moved by the producer
+  std::atomic<std::size_t> tail{0};
+  std::atomic<uint64_t> dropped{0};
+};
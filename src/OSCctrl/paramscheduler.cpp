@@ -0,0 +1,70 @@
+#include "paramscheduler.hpp"
+
+#include <algorithm>
+
+ParamScheduler::ParamScheduler() {
+  for (std::size_t i = 0; i < PARAM_SCHEDULER_QUEUE_SIZE; i++)
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool ParamScheduler::schedule(double time, const ParamUpdate& update) {
+  std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+  Cell* cell;
+
+  for (;;) {
+    cell = &cells[position & (PARAM_SCHEDULER_QUEUE_SIZE - 1)];
+    std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+    if (difference == 0) {
+      if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+    } else if (difference < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->entry.time = time;
+  cell->entry.update = update;
+  cell->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool ParamScheduler::later(const Entry& a, const Entry& b) {
+  if (a.time != b.time) return a.time > b.time;
+  return a.sequence > b.sequence;
+}
+
+void ParamScheduler::collect() {
+  if (clearRequested.exchange(false)) heapSize = 0;
+
+  for (;;) {
+    Cell& cell = cells[dequeuePosition & (PARAM_SCHEDULER_QUEUE_SIZE - 1)];
+    std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (sequence != dequeuePosition + 1) return;
+
+    if (heapSize == PARAM_SCHEDULER_HEAP_SIZE) {
+      // leave it queued until something's been applied
+      return;
+    }
+
+    Entry& entry = heap[heapSize++];
+    entry = cell.entry;
+    entry.sequence = nextSequence++;
+    std::push_heap(heap, heap + heapSize, later);
+
+    cell.sequence.store(dequeuePosition + PARAM_SCHEDULER_QUEUE_SIZE, std::memory_order_release);
+    ++dequeuePosition;
+  }
+}
+
+bool ParamScheduler::popDue(double now, ParamUpdate& update) {
+  if (heapSize == 0 || heap[0].time > now) return false;
+
+  update = heap[0].update;
+  std::pop_heap(heap, heap + heapSize, later);
+  --heapSize;
+  return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "paramtable.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// both must be powers of two
+#define PARAM_SCHEDULER_QUEUE_SIZE 4096
+#define PARAM_SCHEDULER_HEAP_SIZE 4096
+
+// param changes to apply at a given time, in seconds on rack's
+// system::getTime() clock.
+//
+// any thread can schedule, through a bounded lock-free queue. the audio
+// thread collects new entries into a time-ordered heap once per block
+// and pops whatever is due as it steps through the block's samples.
+// nothing here allocates or locks after construction.
+struct ParamScheduler {
+  ParamScheduler();
+
+  // false (and counted as dropped) when the queue is full
+  bool schedule(double time, const ParamUpdate& update);
+
+  // audio thread only
+  void collect();
+  bool popDue(double now, ParamUpdate& update);
+  double nextTime() const { return heapSize > 0 ? heap[0].time : std::numeric_limits<double>::infinity(); }
+
+  // takes effect on the next collect
+  void clear() { clearRequested = true; }
+
+  uint64_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  struct Entry {
+    double time;
+    // keeps updates for the same time in arrival order
+    uint64_t sequence;
+    ParamUpdate update;
+  };
+
+  // bounded mpmc queue (vyukov), each cell's sequence says whether
+  // it's free for the producer at that position or full for the consumer
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    Entry entry;
+  };
+  Cell cells[PARAM_SCHEDULER_QUEUE_SIZE];
+  std::atomic<std::size_t> enqueuePosition{0};
+  std::size_t dequeuePosition{0};
+
+  Entry heap[PARAM_SCHEDULER_HEAP_SIZE];
+  std::size_t heapSize{0};
+  uint64_t nextSequence{0};
+
+  std::atomic<bool> clearRequested{false};
+  std::atomic<uint64_t> dropped{0};
+
+  static bool later(const Entry& a, const Entry& b);
+};
@@ -0,0 +1,73 @@
+#include "paramtable.hpp"
+
+static std::size_t slotIndex(int64_t moduleId, int paramId) {
+  uint64_t hash = (uint64_t)moduleId * 0x9e3779b97f4a7c15ull ^ (uint64_t)(uint32_t)paramId * 0xc2b2ae3d27d4eb4full;
+  return (hash >> 32) & (PARAM_UPDATE_TABLE_SIZE - 1);
+}
+
+ParamUpdateTable::ParamUpdateTable() {
+  dirty.reserve(PARAM_UPDATE_TABLE_SIZE);
+}
+
+void ParamUpdateTable::setLocked(int64_t moduleId, int paramId, float value) {
+  std::size_t index = slotIndex(moduleId, paramId);
+
+  for (;;) {
+    Slot& slot = slots[index];
+
+    if (!slot.used) {
+      // keep the probe sequences short
+      if (dirty.size() >= PARAM_UPDATE_TABLE_SIZE / 4 * 3) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+
+      slot.moduleId = moduleId;
+      slot.paramId = paramId;
+      slot.value = value;
+      slot.used = true;
+      dirty.push_back(index);
+      return;
+    }
+
+    if (slot.moduleId == moduleId && slot.paramId == paramId) {
+      slot.value = value;
+      return;
+    }
+
+    index = (index + 1) & (PARAM_UPDATE_TABLE_SIZE - 1);
+  }
+}
+
+void ParamUpdateTable::set(int64_t moduleId, int paramId, float value) {
+  std::lock_guard<std::mutex> lock(tmutex);
+  setLocked(moduleId, paramId, value);
+  pending.store(dirty.size(), std::memory_order_relaxed);
+}
+
+void ParamUpdateTable::set(const ParamUpdate* updates, std::size_t count) {
+  std::lock_guard<std::mutex> lock(tmutex);
+  for (std::size_t i = 0; i < count; i++)
+    setLocked(updates[i].moduleId, updates[i].paramId, updates[i].value);
+  pending.store(dirty.size(), std::memory_order_relaxed);
+}
+
+void ParamUpdateTable::drain(std::vector<ParamUpdate>& updates) {
+  updates.clear();
+
+  std::lock_guard<std::mutex> lock(tmutex);
+  for (int index : dirty) {
+    Slot& slot = slots[index];
+    updates.push_back(ParamUpdate{slot.moduleId, slot.paramId, slot.value});
+    slot.used = false;
+  }
+  dirty.clear();
+  pending.store(0, std::memory_order_relaxed);
+}
+
+void ParamUpdateTable::clear() {
+  std::lock_guard<std::mutex> lock(tmutex);
+  for (int index : dirty) slots[index].used = false;
+  dirty.clear();
+  pending.store(0, std::memory_order_relaxed);
+}
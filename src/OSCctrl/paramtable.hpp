@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// must be a power of two. more distinct params than 3/4 of this in
+// one frame are dropped (and counted).
+#define PARAM_UPDATE_TABLE_SIZE 1024
+
+struct ParamUpdate {
+  int64_t moduleId;
+  int paramId;
+  float value;
+};
+
+// inbound param values waiting for the engine, keyed by module and param
+// id. setting a param that's already pending just replaces its value, so
+// a frame costs at most one update per param however many arrive.
+//
+// storage is fixed, a whole batch is merged under one short lock and
+// the engine side swaps everything out once per frame.
+struct ParamUpdateTable {
+  ParamUpdateTable();
+
+  void set(int64_t moduleId, int paramId, float value);
+  void set(const ParamUpdate* updates, std::size_t count);
+
+  // replaces the contents of `updates` with everything pending, in the
+  // order params were first set since the last drain
+  void drain(std::vector<ParamUpdate>& updates);
+  void clear();
+
+  bool empty() const { return pending.load(std::memory_order_relaxed) == 0; }
+  uint64_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot {
+    int64_t moduleId;
+    int paramId;
+    float value;
+    bool used{false};
+  };
+
+  std::mutex tmutex;
+  Slot slots[PARAM_UPDATE_TABLE_SIZE];
+  std::vector<int> dirty;
+
+  std::atomic<std::size_t> pending{0};
+  std::atomic<uint64_t> dropped{0};
+
+  void setLocked(int64_t moduleId, int paramId, float value);
+};
@@ -0,0 +1,40 @@
+#include "rtstats.hpp"
+
+// only the audio thread raises, so a plain load and store will do
+static void raise(std::atomic<int64_t>& max, int64_t value) {
+  if (value > max.load(std::memory_order_relaxed)) max.store(value, std::memory_order_relaxed);
+}
+
+void RtStats::onBlock(int64_t now, double blockDuration) {
+  int64_t gap = now - lastBlock;
+  if (lastBlock != 0 && gap < MAX_BLOCK_GAP_NS && gap > blockDuration * LATE_BLOCK_FACTOR * 1e9)
+    lateBlocks.fetch_add(1, std::memory_order_relaxed);
+
+  lastBlock = now;
+  blocks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RtStats::onProcess(int64_t ns) {
+  raise(maxProcessNs, ns);
+}
+
+void RtStats::onApplied(int64_t latencyNs) {
+  applied.fetch_add(1, std::memory_order_relaxed);
+  latencyTotalNs.fetch_add(latencyNs, std::memory_order_relaxed);
+  latencyCount.fetch_add(1, std::memory_order_relaxed);
+  raise(maxLatencyNs, latencyNs);
+}
+
+RtStats::Snapshot RtStats::take() {
+  Snapshot snapshot;
+  snapshot.blocks = blocks.load(std::memory_order_relaxed);
+  snapshot.lateBlocks = lateBlocks.load(std::memory_order_relaxed);
+  snapshot.applied = applied.load(std::memory_order_relaxed);
+  snapshot.maxProcessNs = maxProcessNs.exchange(0, std::memory_order_relaxed);
+
+  int64_t total = latencyTotalNs.exchange(0, std::memory_order_relaxed);
+  uint64_t count = latencyCount.exchange(0, std::memory_order_relaxed);
+  snapshot.meanLatencyNs = count ? total / (int64_t)count : 0;
+  snapshot.maxLatencyNs = maxLatencyNs.exchange(0, std::memory_order_relaxed);
+  return snapshot;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// a block that starts this many block durations after the previous one
+// started is counted late, the engine either xran or came close
+#define LATE_BLOCK_FACTOR 2.0
+// longer gaps than this are the engine stopping and starting, not xruns
+#define MAX_BLOCK_GAP_NS 1000000000
+
+// what OSCctrl::process costs the audio thread, and how long param
+// writes wait to be applied. written on the audio thread without
+// locking, read from anywhere.
+struct RtStats {
+  struct Snapshot {
+    uint64_t blocks;
+    uint64_t lateBlocks;
+    uint64_t applied;
+    // the most a single process call took doing any work
+    int64_t maxProcessNs;
+    int64_t meanLatencyNs;
+    int64_t maxLatencyNs;
+  };
+
+  // audio thread
+  void onBlock(int64_t now, double blockDuration);
+  void onProcess(int64_t ns);
+  void onApplied(int64_t latencyNs);
+
+  // maxima and the latency mean start over after every take
+  Snapshot take();
+
+private:
+  int64_t lastBlock{0};
+
+  std::atomic<uint64_t> blocks{0};
+  std::atomic<uint64_t> lateBlocks{0};
+  std::atomic<uint64_t> applied{0};
+  std::atomic<int64_t> maxProcessNs{0};
+  std::atomic<int64_t> latencyTotalNs{0};
+  std::atomic<uint64_t> latencyCount{0};
+  std::atomic<int64_t> maxLatencyNs{0};
+};
@@ -0,0 +1,184 @@
+#include "shmring.hpp"
+
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shm ring needs lock-free 64 bit atomics");
+
+// marks the unused tail end of the data area, the next record starts at 0
+#define SHM_RING_WRAP 0xffffffffu
+
+static inline std::size_t recordSize(std::size_t size) {
+  // length prefix + payload padded to 4 bytes, like osc itself
+  return sizeof(uint32_t) + ((size + 3) & ~((std::size_t)3));
+}
+
+ShmRing::~ShmRing() {
+  close();
+}
+
+#ifndef _WIN32
+bool ShmRing::create(const std::string& _name, std::size_t capacity) {
+  close();
+
+  capacity = (capacity + 3) & ~((std::size_t)3);
+
+  shm_unlink(_name.c_str());
+  int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) return false;
+
+  std::size_t size = sizeof(ShmRingHeader) + capacity;
+  if (ftruncate(fd, size) != 0) {
+    ::close(fd);
+    shm_unlink(_name.c_str());
+    return false;
+  }
+
+  void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (region == MAP_FAILED) {
+    shm_unlink(_name.c_str());
+    return false;
+  }
+
+  header = new (region) ShmRingHeader;
+  header->capacity = capacity;
+  header->head.store(0);
+  header->tail.store(0);
+  header->dropped.store(0);
+  header->version = SHM_RING_VERSION;
+  // magic last, an attaching reader checks it
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = SHM_RING_MAGIC;
+
+  data = reinterpret_cast<char*>(region) + sizeof(ShmRingHeader);
+  mappedSize = size;
+  name = _name;
+  owner = true;
+  return true;
+}
+
+bool ShmRing::open(const std::string& _name) {
+  close();
+
+  int fd = shm_open(_name.c_str(), O_RDWR, 0600);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (std::size_t)info.st_size < sizeof(ShmRingHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  void* region = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (region == MAP_FAILED) return false;
+
+  ShmRingHeader* attached = reinterpret_cast<ShmRingHeader*>(region);
+  bool valid =
+    attached->magic == SHM_RING_MAGIC
+      && attached->version == SHM_RING_VERSION
+      && sizeof(ShmRingHeader) + attached->capacity <= (std::size_t)info.st_size;
+  if (!valid) {
+    munmap(region, info.st_size);
+    return false;
+  }
+
+  header = attached;
+  data = reinterpret_cast<char*>(region) + sizeof(ShmRingHeader);
+  mappedSize = info.st_size;
+  name = _name;
+  owner = false;
+  return true;
+}
+
+void ShmRing::close() {
+  if (!header) return;
+
+  munmap(header, mappedSize);
+  if (owner) shm_unlink(name.c_str());
+
+  header = nullptr;
+  data = nullptr;
+  mappedSize = 0;
+  owner = false;
+}
+#else
+// no posix shared memory on windows, the udp transport is used instead
+bool ShmRing::create(const std::string& _name, std::size_t capacity) { return false; }
+bool ShmRing::open(const std::string& _name) { return false; }
+void ShmRing::close() {}
+#endif
+
+bool ShmRing::write(const char* packet, std::size_t size) {
+  if (!header) return false;
+
+  const uint64_t capacity = header->capacity;
+  const std::size_t needed = recordSize(size);
+
+  uint64_t head = header->head.load(std::memory_order_relaxed);
+  uint64_t tail = header->tail.load(std::memory_order_acquire);
+
+  std::size_t pos = head % capacity;
+  std::size_t contiguous = capacity - pos;
+  std::size_t total = contiguous < needed ? contiguous + needed : needed;
+
+  if (needed > capacity || capacity - (head - tail) < total) {
+    header->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (contiguous < needed) {
+    uint32_t wrap = SHM_RING_WRAP;
+    std::memcpy(data + pos, &wrap, sizeof(wrap));
+    head += contiguous;
+    pos = 0;
+  }
+
+  uint32_t length = size;
+  std::memcpy(data + pos, &length, sizeof(length));
+  std::memcpy(data + pos + sizeof(length), packet, size);
+
+  header->head.store(head + needed, std::memory_order_release);
+  return true;
+}
+
+std::size_t ShmRing::read(char* packet, std::size_t capacity) {
+  if (!header) return 0;
+
+  const uint64_t ringCapacity = header->capacity;
+
+  uint64_t tail = header->tail.load(std::memory_order_relaxed);
+  uint64_t head = header->head.load(std::memory_order_acquire);
+
+  while (tail != head) {
+    std::size_t pos = tail % ringCapacity;
+
+    uint32_t length;
+    std::memcpy(&length, data + pos, sizeof(length));
+
+    if (length == SHM_RING_WRAP) {
+      tail += ringCapacity - pos;
+      continue;
+    }
+
+    std::size_t size = length;
+    bool fits = size <= capacity;
+    if (fits) std::memcpy(packet, data + pos + sizeof(length), size);
+
+    tail += recordSize(size);
+    header->tail.store(tail, std::memory_order_release);
+
+    if (fits) return size;
+  }
+
+  header->tail.store(tail, std::memory_order_release);
+  return 0;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define SHM_RING_MAGIC 0x67746e6f // "gtno"
+#define SHM_RING_VERSION 1
+
+// shared between processes, so everything in here must stay lock-free
+// and fixed-layout. head and tail are running byte counts, positions in
+// the data area are taken modulo capacity.
+struct ShmRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+
+  alignas(64) std::atomic<uint64_t> head; // written by the producer
+  alignas(64) std::atomic<uint64_t> tail; // written by the consumer
+  alignas(64) std::atomic<uint64_t> dropped;
+};
+
+// single-producer/single-consumer ring of length-prefixed packets in a
+// shm_open/mmap'd region.
+//
+// doesn't depend on rack so the standalone reader can use it too.
+struct ShmRing {
+  ~ShmRing();
+
+  // create (and own) a new region, replacing any stale one of the same name
+  bool create(const std::string& name, std::size_t capacity);
+  // attach to a region created by the other side
+  bool open(const std::string& name);
+  void close();
+
+  bool isOpen() const { return header != nullptr; }
+  const std::string& getName() const { return name; }
+  std::size_t getCapacity() const { return header ? header->capacity : 0; }
+  uint64_t getDropped() const { return header ? header->dropped.load() : 0; }
+
+  // false (and counted as dropped) if there isn't room for the packet
+  bool write(const char* data, std::size_t size);
+  // copy the next packet into data, returns its size or 0 if empty.
+  // packets larger than capacity are skipped.
+  std::size_t read(char* data, std::size_t capacity);
+
+private:
+  std::string name;
+  bool owner{false};
+  std::size_t mappedSize{0};
+  ShmRingHeader* header{nullptr};
+  char* data{nullptr};
+};
@@ -0,0 +1,62 @@
+#include "shmtransport.hpp"
+#include "../../dep/oscpack/ip/IpEndpointName.h"
+#include "../../dep/oscpack/ip/PacketListener.h"
+
+#include <rack.hpp>
+
+#include <chrono>
+#include <vector>
+
+ShmTransport::~ShmTransport() {
+  close();
+}
+
+bool ShmTransport::open(int listenPort, PacketListener* _listener) {
+  close();
+
+  std::string baseName = "/gtnosft-" + std::to_string(listenPort);
+  if (!tx.create(baseName + "-tx", SHM_RING_CAPACITY) || !rx.create(baseName + "-rx", SHM_RING_CAPACITY)) {
+    WARN("unable to create shared memory rings %s-*", baseName.c_str());
+    tx.close();
+    rx.close();
+    return false;
+  }
+
+  listener = _listener;
+  rxRunning = true;
+  rxThread = std::thread(&ShmTransport::receive, this);
+
+  DEBUG("opened shared memory transport %s-*", baseName.c_str());
+  return true;
+}
+
+void ShmTransport::close() {
+  rxRunning = false;
+  if (rxThread.joinable()) rxThread.join();
+
+  tx.close();
+  rx.close();
+}
+
+void ShmTransport::receive() {
+  std::vector<char> packet(1024 * 64);
+  IpEndpointName sharedMemoryEndpoint;
+
+  // spin briefly after each packet so bursts are picked up right away,
+  // then back off to polling once a millisecond
+  int idle{0};
+  while (rxRunning) {
+    std::size_t size = rx.read(packet.data(), packet.size());
+    if (size > 0) {
+      idle = 0;
+      if (listener) listener->ProcessPacket(packet.data(), (int)size, sharedMemoryEndpoint);
+      continue;
+    }
+
+    if (++idle < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "shmring.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+class PacketListener;
+
+#define SHM_RING_CAPACITY (1024 * 1024 * 8)
+
+// shared memory stand-in for the udp sockets, for when the client runs on
+// the same host and asks for it during the /set_unreal_server_port handshake.
+//
+// `tx` carries the packets OscController would otherwise send, `rx` carries
+// the client's packets and is drained into the router on its own thread.
+struct ShmTransport {
+  ~ShmTransport();
+
+  bool open(int listenPort, PacketListener* listener);
+  void close();
+  bool isOpen() const { return tx.isOpen(); }
+  bool onReceiveThread() const { return std::this_thread::get_id() == rxThread.get_id(); }
+
+  ShmRing tx, rx;
+
+private:
+  PacketListener* listener{nullptr};
+  std::thread rxThread;
+  std::atomic<bool> rxRunning{false};
+  void receive();
+};
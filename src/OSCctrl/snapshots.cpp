@@ -0,0 +1,89 @@
+#include "snapshots.hpp"
+
+#include "../VCVStructure.hpp"
+
+template<typename T>
+Snapshots<T>::Snapshots() : current(std::make_shared<const Map>()) {}
+
+template<typename T>
+typename Snapshots<T>::Version Snapshots<T>::load() const {
+  return std::atomic_load(&current);
+}
+
+template<typename T>
+typename Snapshots<T>::Entry Snapshots<T>::get(int64_t id) const {
+  Version snapshot = load();
+  typename Map::const_iterator it = snapshot->find(id);
+  return it == snapshot->end() ? Entry() : it->second;
+}
+
+template<typename T>
+typename Snapshots<T>::Entry Snapshots<T>::copy(const T& value) {
+  return std::make_shared<const T>(value);
+}
+
+// param light pointers point into the working copy, a snapshot
+// has no use for them
+template<>
+Snapshots<VCVModule>::Entry Snapshots<VCVModule>::copy(const VCVModule& value) {
+  std::shared_ptr<VCVModule> module = std::make_shared<VCVModule>(value);
+  module->ParamLights.clear();
+  return module;
+}
+
+template<typename T>
+void Snapshots<T>::store(Map* next) {
+  std::atomic_store(&current, Version(next));
+  version.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename T>
+void Snapshots<T>::publish(const T& value) {
+  Map* next = new Map(*load());
+  (*next)[value.id] = copy(value);
+  store(next);
+}
+
+template<typename T>
+void Snapshots<T>::publish(const std::vector<const T*>& values) {
+  if (values.empty()) return;
+
+  Map* next = new Map(*load());
+  for (const T* value : values) (*next)[value->id] = copy(*value);
+  store(next);
+}
+
+template<typename T>
+void Snapshots<T>::replace(const std::unordered_map<int64_t, T>& values) {
+  Map* next = new Map;
+  next->reserve(values.size());
+  for (const std::pair<const int64_t, T>& pair : values) (*next)[pair.first] = copy(pair.second);
+  store(next);
+}
+
+template<typename T>
+void Snapshots<T>::erase(int64_t id) {
+  Version snapshot = load();
+  if (snapshot->count(id) == 0) return;
+
+  Map* next = new Map(*snapshot);
+  next->erase(id);
+  store(next);
+}
+
+template<typename T>
+void Snapshots<T>::erase(const std::vector<int64_t>& ids) {
+  if (ids.empty()) return;
+
+  Map* next = new Map(*load());
+  for (int64_t id : ids) next->erase(id);
+  store(next);
+}
+
+template<typename T>
+void Snapshots<T>::clear() {
+  store(new Map);
+}
+
+template class Snapshots<VCVModule>;
+template class Snapshots<VCVCable>;
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// immutable, reference counted copies of descriptors (VCVModule,
+// VCVCable) for the threads that serialize them.
+//
+// the UI thread owns the working maps and is the only writer: after it
+// changes an entry it publishes a copy, which builds a new version of
+// the id -> entry map (sharing every unchanged entry with the old one)
+// and swaps it in atomically. readers load the current version without
+// locking and keep whatever they loaded alive for as long as they hold
+// it, so a descriptor is never seen half written or freed under them.
+template<typename T>
+class Snapshots {
+public:
+  typedef std::shared_ptr<const T> Entry;
+  typedef std::unordered_map<int64_t, Entry> Map;
+  typedef std::shared_ptr<const Map> Version;
+
+  Snapshots();
+
+  // any thread
+  Version load() const;
+  Entry get(int64_t id) const;
+  uint64_t getVersion() const { return version.load(std::memory_order_relaxed); }
+
+  // writer only. entries are keyed by their `id`. every call copies the
+  // id -> entry map, so publish or erase a batch at once where there is one.
+  void publish(const T& value);
+  void publish(const std::vector<const T*>& values);
+  void replace(const std::unordered_map<int64_t, T>& values);
+  void erase(int64_t id);
+  void erase(const std::vector<int64_t>& ids);
+  void clear();
+
+private:
+  Version current;
+  std::atomic<uint64_t> version{0};
+
+  static Entry copy(const T& value);
+  void store(Map* next);
+};
+
+struct VCVModule;
+struct VCVCable;
+typedef Snapshots<VCVModule> ModuleSnapshots;
+typedef Snapshots<VCVCable> CableSnapshots;
+typedef ModuleSnapshots::Entry ModuleSnapshot;
+typedef CableSnapshots::Entry CableSnapshot;
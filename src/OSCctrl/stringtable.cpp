@@ -0,0 +1,37 @@
+#include "stringtable.hpp"
+
+int32_t StringTable::intern(const std::string& text, const StringScope& scope, bool& define) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::unordered_map<std::string, Entry>::iterator it = ids.find(text);
+  if (it == ids.end()) it = ids.emplace(text, Entry{nextId++, false}).first;
+
+  define = !it->second.confirmed;
+  if (define) defined[scope.moduleId].push_back(text);
+  return it->second.id;
+}
+
+void StringTable::confirm(int64_t moduleId) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::unordered_map<int64_t, std::vector<std::string>>::iterator it = defined.find(moduleId);
+  if (it == defined.end()) return;
+
+  for (const std::string& text : it->second) {
+    std::unordered_map<std::string, Entry>::iterator entry = ids.find(text);
+    if (entry != ids.end()) entry->second.confirmed = true;
+  }
+  defined.erase(it);
+}
+
+void StringTable::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  ids.clear();
+  defined.clear();
+  nextId = 0;
+}
+
+std::size_t StringTable::size() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return ids.size();
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "../../dep/oscpack/osc/OscOutboundPacketStream.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// a string argument that goes out either as the text itself or,
+// once interned, as the int32 id of a `/strings/define`
+struct StringArg {
+  const char* text;
+  int32_t id;
+
+  StringArg(const char* _text) : text(_text), id(-1) {}
+  StringArg(int32_t _id) : text(nullptr), id(_id) {}
+};
+
+inline osc::OutboundPacketStream& operator<<(osc::OutboundPacketStream& stream, const StringArg& arg) {
+  if (arg.text) return stream << arg.text;
+  return stream << (osc::int32)arg.id;
+}
+
+// the module whose sync an encoding is for, the client's ack of that
+// sync is what tells us it has the strings defined in it
+struct StringScope {
+  int64_t moduleId;
+
+  StringScope(int64_t _moduleId) : moduleId(_moduleId) {}
+};
+
+// per-session table of strings sent to the client as
+// `/strings/define <id> <text>`. it outlives patch loads and
+// re-handshakes, so a repeated sync only defines strings the client
+// doesn't have yet.
+//
+// a string is defined again alongside every use until a module sync
+// that carried its define is acked, so losing the datagram with the
+// first define can't leave another module's sync referring to an id
+// the client never got. the client treats a repeated define as a no-op.
+//
+// an ack doesn't say which send of a module it's for, so a late ack of
+// an older sync confirms strings a newer one introduced.
+struct StringTable {
+  // sets define when the caller has to send the definition
+  int32_t intern(const std::string& text, const StringScope& scope, bool& define);
+  // the client acked a sync of the module
+  void confirm(int64_t moduleId);
+  void clear();
+
+  std::size_t size();
+
+private:
+  struct Entry {
+    int32_t id;
+    bool confirmed;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<std::string, Entry> ids;
+  // unconfirmed strings defined in each module's syncs
+  std::unordered_map<int64_t, std::vector<std::string>> defined;
+  int32_t nextId{0};
+};
@@ -0,0 +1,93 @@
+#include "syncclock.hpp"
+
+#include <algorithm>
+
+SyncClock::SyncClock() {
+  rates[SyncStream::LightStream] = DEFAULT_LIGHT_RATE;
+  rates[SyncStream::ParamStream] = DEFAULT_PARAM_RATE;
+  rates[SyncStream::DiffStream] = DEFAULT_DIFF_RATE;
+  for (int i = 0; i < SYNC_STREAM_COUNT; i++) ticks[i] = 0;
+}
+
+SyncClock::~SyncClock() {
+  stop();
+}
+
+void SyncClock::setHandler(SyncStream stream, const Handler& handler) {
+  handlers[stream] = handler;
+}
+
+void SyncClock::start() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (running) return;
+
+  running = true;
+  context = rack::contextGet();
+  thread = std::thread(&SyncClock::run, this);
+}
+
+void SyncClock::stop() {
+  std::unique_lock<std::mutex> locker(mutex);
+  running = false;
+  locker.unlock();
+  wake.notify_all();
+
+  if (thread.joinable()) thread.join();
+}
+
+void SyncClock::setRate(SyncStream stream, float hz) {
+  rates[stream] = std::min(std::max(hz, 0.f), MAX_SYNC_RATE);
+
+  std::unique_lock<std::mutex> locker(mutex);
+  changed = true;
+  locker.unlock();
+  wake.notify_all();
+}
+
+void SyncClock::run() {
+  rack::contextSet(context);
+
+  Clock::time_point deadlines[SYNC_STREAM_COUNT];
+  Clock::duration periods[SYNC_STREAM_COUNT];
+
+  std::unique_lock<std::mutex> locker(mutex);
+  changed = true;
+
+  while (running) {
+    Clock::time_point now = Clock::now();
+
+    if (changed) {
+      changed = false;
+      for (int i = 0; i < SYNC_STREAM_COUNT; i++) {
+        float rate = rates[i];
+        periods[i] = rate > 0.f
+          ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate))
+          : Clock::duration::zero();
+        deadlines[i] = now + periods[i];
+      }
+    }
+
+    Clock::time_point next = Clock::time_point::max();
+    for (int i = 0; i < SYNC_STREAM_COUNT; i++) {
+      if (periods[i] == Clock::duration::zero()) continue;
+
+      if (deadlines[i] <= now) {
+        locker.unlock();
+        ticks[i]++;
+        if (handlers[i]) handlers[i]();
+        locker.lock();
+
+        deadlines[i] += periods[i];
+        if (deadlines[i] <= now) deadlines[i] = now + periods[i];
+      }
+      next = std::min(next, deadlines[i]);
+    }
+
+    if (!running || changed) continue;
+    if (next == Clock::time_point::max()) {
+      wake.wait(locker);
+    } else {
+      wake.wait_until(locker, next);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <rack.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// in hz
+#define DEFAULT_LIGHT_RATE 60.f
+#define DEFAULT_PARAM_RATE 60.f
+#define DEFAULT_DIFF_RATE 30.f
+#define MAX_SYNC_RATE 1000.f
+
+enum SyncStream {
+  LightStream,
+  ParamStream,
+  DiffStream,
+  SYNC_STREAM_COUNT
+};
+
+// paces the periodic streams on its own thread off the steady clock,
+// so they keep time whatever the engine is doing: paused, at another
+// sample rate or stalled on a slow block.
+//
+// each stream ticks at its own rate. ticks are scheduled from the
+// previous deadline so they don't drift, a tick that's missed entirely
+// (the machine was suspended, say) is skipped rather than bunched up.
+//
+// handlers run on the clock thread, with the rack context of whoever
+// started it, and should only hand work off.
+struct SyncClock {
+  typedef std::chrono::steady_clock Clock;
+  typedef std::function<void()> Handler;
+
+  SyncClock();
+  ~SyncClock();
+
+  // set before start
+  void setHandler(SyncStream stream, const Handler& handler);
+  void start();
+  void stop();
+
+  // 0 pauses the stream
+  void setRate(SyncStream stream, float hz);
+  float getRate(SyncStream stream) const { return rates[stream].load(); }
+  uint64_t getTicks(SyncStream stream) const { return ticks[stream].load(); }
+
+private:
+  std::thread thread;
+  rack::Context* context{nullptr};
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool running{false};
+  // a rate changed, reschedule
+  bool changed{false};
+
+  Handler handlers[SYNC_STREAM_COUNT];
+  std::atomic<float> rates[SYNC_STREAM_COUNT];
+  std::atomic<uint64_t> ticks[SYNC_STREAM_COUNT];
+
+  void run();
+};
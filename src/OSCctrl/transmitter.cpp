@@ -0,0 +1,105 @@
+#include "transmitter.hpp"
+#include "../../dep/oscpack/ip/UdpSocket.h"
+
+#include <rack.hpp>
+
+#include <stdexcept>
+
+Transmitter::~Transmitter() {
+  disconnect();
+  for (PacketBuffer* packet : batchPackets) pool.release(packet);
+}
+
+void Transmitter::connect(const IpEndpointName& endpoint) {
+  std::lock_guard<std::mutex> lock(txmutex);
+
+  if (socket) delete socket;
+  socket = nullptr;
+
+  try {
+    socket = new UdpTransmitSocket(endpoint);
+  } catch (std::runtime_error& err) {
+    WARN("unable to connect transmit socket: %s", err.what());
+  }
+}
+
+void Transmitter::disconnect() {
+  std::lock_guard<std::mutex> lock(txmutex);
+  if (socket) delete socket;
+  socket = nullptr;
+}
+
+bool Transmitter::isConnected() {
+  std::lock_guard<std::mutex> lock(txmutex);
+  return socket != nullptr;
+}
+
+void Transmitter::useRing(ShmRing* _ring) {
+  std::lock_guard<std::mutex> lock(txmutex);
+  ring = _ring;
+}
+
+void Transmitter::send(PacketBuffer* packet) {
+  if (ring || std::this_thread::get_id() != batchThreadId) {
+    sendNow(packet->data, packet->size);
+    pool.release(packet);
+    return;
+  }
+
+  batchPackets.push_back(packet);
+  batch(packet->data, packet->size);
+}
+
+void Transmitter::send(const char* data, std::size_t size, const std::shared_ptr<const void>& owner) {
+  if (ring || std::this_thread::get_id() != batchThreadId) {
+    sendNow(data, size);
+    return;
+  }
+
+  batchOwners.push_back(owner);
+  batch(data, size);
+}
+
+void Transmitter::batch(const char* data, std::size_t size) {
+  batchPointers.push_back(data);
+  batchSizes.push_back(size);
+
+  // held packets come out of the shared pool, don't starve other senders
+  if ((int)batchPointers.size() >= MAX_BATCH_PACKETS || pool.getAvailable() < pool.getCapacity() / 4)
+    flush();
+}
+
+void Transmitter::sendNow(const char* data, std::size_t size) {
+  std::lock_guard<std::mutex> lock(txmutex);
+
+  // producers are serialized here, which keeps the ring single-producer
+  if (ring) {
+    if (!ring.load()->write(data, size))
+      WARN("shared memory ring full, dropped %lld byte packet", (long long)size);
+    return;
+  }
+
+  if (!socket) return;
+  socket->Send(data, size);
+}
+
+void Transmitter::flush() {
+  if (batchPointers.empty()) return;
+
+  std::unique_lock<std::mutex> locker(txmutex);
+  if (ring) {
+    for (std::size_t i = 0; i < batchPointers.size(); i++)
+      ring.load()->write(batchPointers[i], batchSizes[i]);
+  } else if (socket) {
+    int sent = socket->SendMultiple(batchPointers.data(), batchSizes.data(), batchPointers.size());
+    if (sent < (int)batchPointers.size())
+      WARN("transmitter skipped %lld of %lld datagrams", (long long)(batchPointers.size() - sent), (long long)batchPointers.size());
+  }
+  locker.unlock();
+
+  for (PacketBuffer* packet : batchPackets) pool.release(packet);
+  batchPackets.clear();
+  batchOwners.clear();
+  batchPointers.clear();
+  batchSizes.clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "../../dep/oscpack/ip/IpEndpointName.h"
+#include "shmring.hpp"
+#include "packetpool.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class UdpTransmitSocket;
+
+// owns the long-lived, connected socket to the unreal server
+// (or the shared memory ring standing in for it).
+//
+// datagrams sent from the batch thread (the queue worker) are held until
+// `flush` and handed to the kernel together, anything sent from another
+// thread goes out immediately.
+//
+// packets are encoded straight into buffers from `acquire` and handed
+// over by pointer, the transmitter releases them back to the pool once
+// they've been sent. bytes someone else keeps (cached syncs) are sent
+// in place, held by a reference until they're on the wire.
+struct Transmitter {
+  ~Transmitter();
+
+  void connect(const IpEndpointName& endpoint);
+  void disconnect();
+  bool isConnected();
+
+  void setBatchThread(std::thread::id threadId) { batchThreadId = threadId; }
+
+  // when set, packets are written to the shared memory ring instead of
+  // the socket. ring writes are cheap, so they are never batched.
+  void useRing(ShmRing* ring);
+
+  PacketBuffer* acquire() { return pool.acquire(); }
+  // for packets that end up not being sent
+  void release(PacketBuffer* packet) { pool.release(packet); }
+  PacketPool::Stats getPoolStats() const { return pool.getStats(); }
+
+  // takes ownership of the packet
+  void send(PacketBuffer* packet);
+  // `owner` keeps `data` alive until it's been sent
+  void send(const char* data, std::size_t size, const std::shared_ptr<const void>& owner);
+  void flush();
+
+private:
+  std::mutex txmutex;
+  UdpTransmitSocket* socket{nullptr};
+  std::atomic<ShmRing*> ring{nullptr};
+
+  // sendmmsg takes at most this many datagrams at once, flush early if we hit it
+  static const int MAX_BATCH_PACKETS = 1024;
+
+  PacketPool pool;
+
+  std::thread::id batchThreadId;
+  std::vector<PacketBuffer*> batchPackets;
+  std::vector<std::shared_ptr<const void>> batchOwners;
+  std::vector<const char*> batchPointers;
+  std::vector<std::size_t> batchSizes;
+
+  void sendNow(const char* data, std::size_t size);
+  void batch(const char* data, std::size_t size);
+};
@@ -1,6 +1,5 @@
 #include "OscController.hpp"
-
-#include "../dep/oscpack/ip/UdpSocket.h"
+#include "OscPattern.hpp"
 
 #include <plugin.hpp>
 #include <patch.hpp>
@@ -10,45 +9,125 @@
 #include <jansson.h>
 
 #include <chrono>
+#include <cmath>
 #include <cstring>
+#include <limits>
 #include <random>
 #include <sstream>
 #include <algorithm>
 
 OscController::OscController() {
   queueWorker = std::thread(OscController::processQueue, this);
+
+  for (int i = 0; i < SYNC_STREAM_COUNT; i++) {
+    SyncStream stream = (SyncStream)i;
+    streamDue[i] = false;
+    syncClock.setHandler(stream, [this, stream]() { onSyncTick(stream); });
+  }
+  syncClock.start();
 }
 
 OscController::~OscController() {
+  syncClock.stop();
+
+  Transmittr.useRing(nullptr);
+  Shm.close();
+
   queueWorkerRunning = false;
 
   // give the queue a reason to spin around one more time to exit
-  Command command;
-  command.first = CommandType::Noop;
-  std::unique_lock<std::mutex> locker(qmutex);
-  commandQueue.push(command);
-  locker.unlock();
-  queueLockCondition.notify_one();
+  commandQueue.push(QueuedCommand(CommandType::Noop));
+  wakeQueueWorker();
 
   if (queueWorker.joinable()) queueWorker.join();
+}
 
-  delete[] oscBuffer;
+// clock thread
+void OscController::onSyncTick(SyncStream stream) {
+  streamDue[stream] = true;
+  if (stream == SyncStream::LightStream && !needsSync) enqueueLightUpdates();
+  if (stream == SyncStream::ParamStream) flushParamUpdates();
 }
 
-float_time_point OscController::getCurrentTime() {
-  return Time::now();
+void OscController::setSyncRate(const char* stream, float hz) {
+  static const char* names[SYNC_STREAM_COUNT] = {"lights", "params", "diffs"};
+
+  for (int i = 0; i < SYNC_STREAM_COUNT; i++) {
+    if (std::strcmp(stream, names[i]) != 0) continue;
+    syncClock.setRate((SyncStream)i, hz);
+    INFO("%s sync rate %f hz", names[i], syncClock.getRate((SyncStream)i));
+    return;
+  }
+  WARN("no sync stream %s", stream);
 }
 
-void OscController::setUnrealServerPort(const int& port) {
-  unrealServerEndpoint = IpEndpointName("127.0.0.1", port);
+// `/pacing <float bytesPerSecond> <float burstBytes>`, the rate is a maximum
+// the pacer adapts below
+void OscController::setPacing(float bytesPerSecond, float burstBytes) {
+  if (!(bytesPerSecond > 0.f) || !(burstBytes > 0.f)) {
+    WARN("ignoring pacing %f bytes/s, %f bytes burst", bytesPerSecond, burstBytes);
+    return;
+  }
+
+  Pacr.configure(bytesPerSecond, burstBytes);
+  INFO("pacing at most %f bytes/s, %f bytes burst", Pacr.getRate(), burstBytes);
+}
 
-  osc::OutboundPacketStream buffer(oscBuffer, OSC_BUFFER_SIZE);
+Time::time_point OscController::getCurrentTime() {
+  return Time::now();
+}
+
+void OscController::setUnrealServerPort(const int& port, const std::vector<std::string>& options) {
+  if (Shm.onReceiveThread()) {
+    WARN("ignoring /set_unreal_server_port over shared memory, handshake must use udp");
+    return;
+  }
 
+  unrealServerEndpoint = IpEndpointName("127.0.0.1", port);
+  Transmittr.useRing(nullptr);
+  Shm.close();
+  Transmittr.connect(unrealServerEndpoint);
+
+  bool useShm =
+    std::find(options.begin(), options.end(), std::string("shm")) != options.end()
+      && Shm.open(ctrlListenPort, packetListener);
+  lightFrames =
+    std::find(options.begin(), options.end(), std::string("light_frames")) != options.end();
+  menuAcks =
+    std::find(options.begin(), options.end(), std::string("menu_acks")) != options.end();
+  bool wasInterning = internStrings;
+  internStrings =
+    std::find(options.begin(), options.end(), std::string("strings")) != options.end();
+  // cached syncs were encoded for the other string format
+  if (internStrings != wasInterning) bundleCache.clear();
+
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream buffer(packet->data, packet->capacity);
+
+  // echo back the options we agreed to
   buffer << osc::BeginMessage("/set_rack_server_port")
-    << ctrlListenPort
+    << ctrlListenPort;
+  if (useShm) buffer << "shm";
+  if (lightFrames) buffer << "light_frames";
+  if (internStrings) buffer << "strings";
+  if (menuAcks) buffer << "menu_acks";
+  buffer << osc::EndMessage;
+
+  sendMessage(packet, buffer);
+
+  if (!useShm) return;
+
+  // the handshake goes over udp, everything after it over the rings
+  packet.reset(Transmittr.acquire());
+  buffer = osc::OutboundPacketStream(packet->data, packet->capacity);
+  buffer << osc::BeginMessage("/shm/attach")
+    << Shm.tx.getName().c_str()
+    << Shm.rx.getName().c_str()
+    << (osc::int64)Shm.tx.getCapacity()
     << osc::EndMessage;
 
-  sendMessage(buffer);
+  sendMessage(packet, buffer);
+  Transmittr.useRing(&Shm.tx);
 }
 
 void OscController::reset() {
@@ -56,101 +135,410 @@ void OscController::reset() {
   needsSync = false;
   readyToExit = false;
 
-  std::unique_lock<std::mutex> qlocker(qmutex);
-  while (!commandQueue.empty()) commandQueue.pop();
-  qlocker.unlock();
+  commandQueue.clear();
 
-  std::unique_lock<std::mutex> pulocker(pumutex);
-  pendingParamUpdates.clear();
-  pulocker.unlock();
+  std::unique_lock<std::mutex> acklocker(ackmutex);
+  awaitingAck.clear();
+  acklocker.unlock();
+
+  paramUpdates.clear();
+  paramEchoes.clear();
+  paramScheduler.clear();
 
   std::unique_lock<std::mutex> llocker(lmutex);
-  LightReferences.clear();
+  lightTable.clear();
+  lightSampler.clear();
   llocker.unlock();
 
-  std::unique_lock<std::mutex> cablelocker(cablemutex);
-  cablesToCreate.clear();
-  cablesToDestroy.clear();
-  cablelocker.unlock();
+  interest.clear();
 
-  std::unique_lock<std::mutex> modulelocker(modulemutex);
-  modulesToCreate.clear();
-  modulesToDestroy.clear();
-  modulesToArrange.clear();
-  modulelocker.unlock();
+  // requests against the old patch don't apply to the new one
+  ingress.drain(ingressCommands);
+  ingressCommands.clear();
+  pendingDiffs.clear();
 
   Modules.clear();
   Cables.clear();
+  moduleSnapshots.clear();
+  cableSnapshots.clear();
+}
+
+// everything bundleModule and friends serialize, compared exactly, so a
+// cached sync is only replayed when it would encode to the same bytes
+static bool sameColor(const NVGcolor& a, const NVGcolor& b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static bool sameVec(const rack::math::Vec& a, const rack::math::Vec& b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+static bool sameRect(const rack::math::Rect& a, const rack::math::Rect& b) {
+  return sameVec(a.pos, b.pos) && sameVec(a.size, b.size);
+}
+
+template<typename T, typename Same>
+static bool sameEach(const std::map<int, T>& a, const std::map<int, T>& b, Same same) {
+  if (a.size() != b.size()) return false;
+
+  typename std::map<int, T>::const_iterator ai = a.begin(), bi = b.begin();
+  for (; ai != a.end(); ++ai, ++bi) {
+    if (ai->first != bi->first || !same(ai->second, bi->second)) return false;
+  }
+  return true;
+}
+
+static bool sameLight(const VCVLight& a, const VCVLight& b) {
+  return a.id == b.id
+    && sameRect(a.box, b.box)
+    && sameColor(a.color, b.color)
+    && sameColor(a.bgColor, b.bgColor)
+    && a.shape == b.shape
+    && a.visible == b.visible
+    && a.overlapsParamId == b.overlapsParamId;
+}
+
+static bool sameParam(const VCVParam& a, const VCVParam& b) {
+  return a.id == b.id
+    && a.type == b.type
+    && a.name == b.name
+    && a.displayValue == b.displayValue
+    && a.unit == b.unit
+    && sameRect(a.box, b.box)
+    && a.minValue == b.minValue
+    && a.maxValue == b.maxValue
+    && a.defaultValue == b.defaultValue
+    && a.value == b.value
+    && a.snap == b.snap
+    && a.minAngle == b.minAngle
+    && a.maxAngle == b.maxAngle
+    && sameVec(a.minHandlePos, b.minHandlePos)
+    && sameVec(a.maxHandlePos, b.maxHandlePos)
+    && sameRect(a.handleBox, b.handleBox)
+    && a.horizontal == b.horizontal
+    && a.speed == b.speed
+    && a.momentary == b.momentary
+    && a.visible == b.visible
+    && a.svgPaths == b.svgPaths
+    && sameColor(a.bodyColor, b.bodyColor)
+    && sameEach(a.Lights, b.Lights, sameLight);
+}
+
+static bool samePort(const VCVPort& a, const VCVPort& b) {
+  return a.id == b.id
+    && a.name == b.name
+    && a.description == b.description
+    && sameRect(a.box, b.box)
+    && a.svgPath == b.svgPath
+    && sameColor(a.bodyColor, b.bodyColor)
+    && a.visible == b.visible;
+}
+
+// a module that would sync the same as it did last time keeps its
+// version, so its cached sync can be replayed
+static bool sameModuleContent(const VCVModule& a, const VCVModule& b) {
+  if (a.Displays.size() != b.Displays.size()) return false;
+  for (std::size_t i = 0; i < a.Displays.size(); i++) {
+    if (!sameRect(a.Displays[i].box, b.Displays[i].box)) return false;
+  }
+
+  return a.id == b.id
+    && a.brand == b.brand
+    && a.name == b.name
+    && a.description == b.description
+    && a.slug == b.slug
+    && a.pluginSlug == b.pluginSlug
+    && sameRect(a.box, b.box)
+    && a.panelSvgPath == b.panelSvgPath
+    && sameColor(a.bodyColor, b.bodyColor)
+    && a.returnId == b.returnId
+    && a.leftExpanderId == b.leftExpanderId
+    && a.rightExpanderId == b.rightExpanderId
+    && sameEach(a.Params, b.Params, sameParam)
+    && sameEach(a.Inputs, b.Inputs, samePort)
+    && sameEach(a.Outputs, b.Outputs, samePort)
+    && sameEach(a.Lights, b.Lights, sameLight);
 }
 
 void OscController::collectAndSync() {
+  std::unordered_map<int64_t, VCVModule> previousModules;
+  previousModules.swap(Modules);
+
   reset();
 
   collectModules();
+  for (std::pair<const int64_t, VCVModule>& pair : Modules) {
+    std::unordered_map<int64_t, VCVModule>::iterator previous = previousModules.find(pair.first);
+    if (previous != previousModules.end() && sameModuleContent(previous->second, pair.second)) {
+      pair.second.version = previous->second.version;
+    } else {
+      stampModule(pair.second);
+    }
+  }
+  bundleCache.prune([this](int64_t moduleId) { return Modules.count(moduleId) > 0; });
+  moduleSnapshots.replace(Modules);
   for (auto& pair : Modules) enqueueSyncModule(pair.first);
 
   collectCables();
+  cableSnapshots.replace(Cables);
   for (auto& pair : Cables) enqueueSyncCable(pair.first);
 
   enqueueSyncLibrary();
 }
 
-void OscController::enqueueCommand(Command command) {
+void OscController::enqueueCommand(const QueuedCommand& command) {
+  if (commandQueue.push(command)) wakeQueueWorker();
+}
+
+// the worker announces it's about to sleep before it checks the queue one
+// last time, with the mutex held. so either it sees what was just pushed,
+// or it's visibly waiting and taking the mutex here orders the notify
+// after it has started to wait.
+void OscController::wakeQueueWorker() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!queueWorkerWaiting.load(std::memory_order_relaxed)) return;
+
   std::unique_lock<std::mutex> locker(qmutex);
-  commandQueue.push(command);
   locker.unlock();
   queueLockCondition.notify_one();
 }
 
+template<typename Predicate>
+void OscController::waitForQueue(std::unique_lock<std::mutex>& locker, const Time::time_point* deadline, Predicate predicate) {
+  queueWorkerWaiting.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (deadline) {
+    queueLockCondition.wait_until(locker, *deadline, predicate);
+  } else {
+    queueLockCondition.wait(locker, predicate);
+  }
+
+  queueWorkerWaiting.store(false, std::memory_order_relaxed);
+}
+
 void OscController::processQueue() {
   queueWorkerRunning = true;
+  Transmittr.setBatchThread(std::this_thread::get_id());
 
   while (queueWorkerRunning) {
-    std::unique_lock<std::mutex> locker(qmutex);
-    queueLockCondition.wait(locker, [this](){ return !commandQueue.empty(); });
+    // sleep until there is work or an ack is overdue
+    if (commandQueue.empty()) {
+      std::unique_lock<std::mutex> locker(qmutex);
+      Time::time_point deadline;
+      bool hasDeadline = nextAckDeadline(deadline);
+      waitForQueue(locker, hasDeadline ? &deadline : nullptr, [this](){ return !commandQueue.empty(); });
+    }
+
+    // bulk waits for the pacer, but anything more urgent
+    // that comes in meanwhile goes ahead of it
+    CommandPriority next;
+    if (commandQueue.peek(next) && next == CommandPriority::Bulk) {
+      Time::duration delay = Pacr.bulkDelay();
+      if (delay > Time::duration::zero()) {
+        Transmittr.flush();
+
+        std::unique_lock<std::mutex> locker(qmutex);
+        Time::time_point deadline = getCurrentTime() + delay;
+        waitForQueue(locker, &deadline, [this](){
+          CommandPriority next;
+          return !queueWorkerRunning || (commandQueue.peek(next) && next != CommandPriority::Bulk);
+        });
+        continue;
+      }
+    }
+
+    QueuedCommand command;
+    CommandPriority priority{CommandPriority::Bulk};
+    if (commandQueue.pop(command, priority)) {
+      switch (command.type) {
+        case CommandType::UpdateLights:
+          if (Pacr.allowLightFrame()) sendLightUpdates();
+          break;
+        case CommandType::SyncModule: {
+          // take the rest of the run so it can be encoded in parallel
+          syncModuleCommands.assign(1, command);
+          commandQueue.popRun(
+            CommandType::SyncModule,
+            syncModuleCommands,
+            std::max(1, encoderPool.getThreadCount()) * ENCODER_JOBS_PER_THREAD
+          );
+
+          syncModuleSnapshots.clear();
+          for (QueuedCommand& syncCommand : syncModuleCommands) {
+            ModuleSnapshot module = moduleSnapshots.get(syncCommand.pid);
+            if (module) syncModuleSnapshots.push_back(module);
+          }
+          syncModules(syncModuleSnapshots);
+
+          for (ModuleSnapshot& module : syncModuleSnapshots)
+            awaitAck(CommandType::SyncModule, module->id);
+          syncModuleSnapshots.clear();
+          break;
+        }
+        case CommandType::SyncCable: {
+          CableSnapshot cable = cableSnapshots.get(command.pid);
+          if (!cable) break;
+          DEBUG("tx /cable/add %lld: %lld:%lld", cable->id, cable->inputModuleId, cable->outputModuleId);
+          syncCable(cable.get());
+          awaitAck(CommandType::SyncCable, command.pid);
+          break;
+        }
+        case CommandType::SyncLibrary:
+          DEBUG("syncing library");
+          syncLibrary();
+          break;
+        case CommandType::SyncParam:
+          /* DEBUG("tx /param/sync"); */
+          syncParam(command.pid, command.cid);
+          break;
+        case CommandType::SyncPort:
+          /* DEBUG("tx /port/sync"); */
+          syncPort(command.pid, command.cid, command.portType);
+          break;
+        case CommandType::SyncMenu:
+          /* DEBUG("tx /menu/sync"); */
+          syncMenu(command.pid, command.cid);
+          if (menuAcks) awaitAck(CommandType::SyncMenu, command.pid, command.cid);
+          break;
+        case CommandType::Noop:
+          DEBUG("Q:NOCOMMAND");
+          break;
+        default:
+          break;
+      }
+    }
+
+    // bulk sends go out in one batch once the queue has been drained,
+    // interactive echoes and light frames don't wait for that
+    bool drained = commandQueue.empty();
+    if (drained) retryUnacknowledged();
+    if (drained || priority != CommandPriority::Bulk) Transmittr.flush();
+  }
+}
+
+void OscController::awaitAck(CommandType type, int64_t pid, int cid) {
+  // first wait, doubled on every retry
+  float wait = type == CommandType::SyncModule ? 0.5f : 0.25f;
+
+  std::lock_guard<std::mutex> lock(ackmutex);
+  for (Command& pending : awaitingAck) {
+    if (pending.first == type && pending.second.pid == pid && pending.second.cid == cid) {
+      // resynced before an ack came in, restart the clock but keep the count
+      pending.second.lastCheck = getCurrentTime();
+      return;
+    }
+  }
+  awaitingAck.push_back(Command(type, Payload(pid, cid, getCurrentTime(), wait)));
+}
+
+void OscController::acknowledge(CommandType type, int64_t pid, int cid) {
+  std::lock_guard<std::mutex> lock(ackmutex);
+  for (std::vector<Command>::iterator it = awaitingAck.begin(); it != awaitingAck.end(); ++it) {
+    if (it->first == type && it->second.pid == pid && it->second.cid == cid) {
+      // a resent sync's ack could belong to either send, don't time it
+      if (type == CommandType::SyncModule && it->second.retried == 0)
+        Pacr.onAck(getCurrentTime() - it->second.lastCheck);
 
-    Command command = commandQueue.front();
-    commandQueue.pop();
+      awaitingAck.erase(it);
+      return;
+    }
+  }
+}
 
-    // used for requeueing, see: 41351af3d46a74b1b88b737ad788a68c3ac210d4
-    // auto now = getCurrentTime();
+bool OscController::nextAckDeadline(Time::time_point& deadline) {
+  std::lock_guard<std::mutex> lock(ackmutex);
+  if (awaitingAck.empty()) return false;
+
+  deadline = awaitingAck.front().second.deadline();
+  for (Command& pending : awaitingAck)
+    deadline = std::min(deadline, pending.second.deadline());
+  return true;
+}
+
+void OscController::retryUnacknowledged() {
+  Time::time_point now = getCurrentTime();
+
+  std::vector<Command> retries;
+  std::vector<Command> gaveUp;
+  std::unique_lock<std::mutex> locker(ackmutex);
+  for (std::vector<Command>::iterator it = awaitingAck.begin(); it != awaitingAck.end();) {
+    Payload& payload = it->second;
+    // the client re-handshook without menu acks
+    if (it->first == CommandType::SyncMenu && !menuAcks) {
+      it = awaitingAck.erase(it);
+      continue;
+    }
+
+    if (payload.deadline() > now) {
+      ++it;
+      continue;
+    }
+
+    if (payload.retried >= payload.retryLimit) {
+      WARN("giving up on sync %d for %lld:%d after %d retries", it->first, payload.pid, payload.cid, payload.retried);
+      syncGiveUps.fetch_add(1, std::memory_order_relaxed);
+      gaveUp.push_back(*it);
+      it = awaitingAck.erase(it);
+      continue;
+    }
+
+    if (it->first == CommandType::SyncModule) Pacr.onLoss();
+
+    ++payload.retried;
+    payload.wait = std::min(payload.wait * 2.f, 4.f);
+    payload.lastCheck = now;
+    retries.push_back(*it);
+    ++it;
+  }
+  locker.unlock();
+
+  for (Command& command : gaveUp) sendSyncGaveUp(command.first, command.second.pid, command.second.cid);
+
+  // resends queue up again like the first send did, so they're paced
+  // behind everything else in bulk
+  for (Command& command : retries) {
+    DEBUG("resending sync %d for %lld:%d (retry %d)", command.first, command.second.pid, command.second.cid, command.second.retried);
 
     switch (command.first) {
-      case CommandType::UpdateLights:
-        sendLightUpdates();
-        break;
       case CommandType::SyncModule:
-        syncModule(&Modules[command.second.pid]);
+        if (moduleSnapshots.get(command.second.pid)) {
+          enqueueSyncModule(command.second.pid);
+        } else {
+          acknowledge(command.first, command.second.pid);
+        }
         break;
       case CommandType::SyncCable:
-        DEBUG("tx /cable/add %lld: %lld:%lld", command.second.pid, Cables[command.second.pid].inputModuleId, Cables[command.second.pid].outputModuleId);
-        syncCable(&Cables[command.second.pid]);
-        break;
-      case CommandType::SyncLibrary:
-        DEBUG("syncing library");
-        syncLibrary();
-        break;
-      case CommandType::SyncParam:
-        /* DEBUG("tx /param/sync"); */
-        syncParam(command.second.pid, command.second.cid);
-        break;
-      case CommandType::SyncPort:
-        /* DEBUG("tx /port/sync"); */
-        syncPort(command.second.pid, command.second.cid, command.second.portType);
+        if (cableSnapshots.get(command.second.pid)) {
+          enqueueSyncCable(command.second.pid);
+        } else {
+          acknowledge(command.first, command.second.pid);
+        }
         break;
       case CommandType::SyncMenu:
-        /* DEBUG("tx /menu/sync"); */
-        syncMenu(command.second.pid, command.second.cid);
-        break;
-      case CommandType::Noop:
-        DEBUG("Q:NOCOMMAND");
+        enqueueSyncMenu(command.second.pid, command.second.cid);
         break;
       default:
         break;
     }
   }
 }
- 
+
+// `/sync/gave_up <int type> <int64 pid> <int cid>` tells the client a sync
+// went unacked past its last retry and won't be resent
+void OscController::sendSyncGaveUp(CommandType type, int64_t pid, int cid) {
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream message(packet->data, packet->capacity);
+
+  message << osc::BeginMessage("/sync/gave_up")
+    << (int)type
+    << pid
+    << cid
+    << osc::EndMessage;
+
+  sendMessage(packet, message);
+}
+
 void OscController::collectModules() {
   DEBUG("collecting %lld modules", getModuleIds().size());
   for (int64_t& moduleId: getModuleIds()) {
@@ -159,6 +547,14 @@ void OscController::collectModules() {
   DEBUG("collected %lld modules", Modules.size());
 }
 
+void OscController::publishModule(int64_t moduleId) {
+  if (Modules.count(moduleId) == 0) return;
+
+  VCVModule& module = Modules.at(moduleId);
+  stampModule(module);
+  moduleSnapshots.publish(module);
+}
+
 void OscController::collectCables(bool printResults) {
   DEBUG("collecting %lld cables", APP->engine->getCableIds().size());
 	for (int64_t& cableId: APP->engine->getCableIds()) {
@@ -169,6 +565,10 @@ void OscController::collectCables(bool printResults) {
   if (printResults) printCables();
 }
 
+void OscController::publishCable(int64_t cableId) {
+  if (Cables.count(cableId) > 0) cableSnapshots.publish(Cables.at(cableId));
+}
+
 void OscController::printCables() {
   for (std::pair<int64_t, VCVCable> cable_pair : Cables) {
     VCVModule* inputModule = &Modules[cable_pair.second.inputModuleId];
@@ -185,13 +585,44 @@ void OscController::printCables() {
   }
 }
 
-void OscController::bundleParam(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVParam* param) {
+StringArg OscController::internString(osc::OutboundPacketStream& bundle, const StringScope& scope, const std::string& text) {
+  if (!internStrings) return StringArg(text.c_str());
+
+  bool define;
+  int32_t id = Strings.intern(text, scope, define);
+
+  // the define travels in the same group as the use, so it can't be
+  // split from it. until the client acks a sync that carried it, every
+  // use defines it again in case that datagram was lost.
+  if (define) {
+    bundle << osc::BeginMessage("/strings/define")
+      << id
+      << text.c_str()
+      << osc::EndMessage;
+  }
+
+  return StringArg(id);
+}
+
+void OscController::clearStrings(int64_t outerId, int innerId, float value) {
+  stringTableCleared = true;
+}
+
+void OscController::bundleParam(osc::OutboundPacketStream& bundle, const StringScope& scope, int64_t moduleId, const VCVParam* param) {
+  StringArg svgPaths[5] = {
+    internString(bundle, scope, param->svgPaths[0]),
+    internString(bundle, scope, param->svgPaths[1]),
+    internString(bundle, scope, param->svgPaths[2]),
+    internString(bundle, scope, param->svgPaths[3]),
+    internString(bundle, scope, param->svgPaths[4])
+  };
+
   bundle << osc::BeginMessage("/modules/param/add")
     << moduleId
     << param->id
     << param->type
     << param->name.c_str()
-    << (param->displayValue.append(param->unit)).c_str()
+    << (param->displayValue + param->unit).c_str()
     << param->box.pos.x
     << param->box.pos.y
     << param->box.size.x
@@ -215,18 +646,18 @@ void OscController::bundleParam(osc::OutboundPacketStream& bundle, int64_t modul
     << param->speed
     << param->momentary
     << param->visible
-    << param->svgPaths[0].c_str()
-    << param->svgPaths[1].c_str()
-    << param->svgPaths[2].c_str()
-    << param->svgPaths[3].c_str()
-    << param->svgPaths[4].c_str()
+    << svgPaths[0]
+    << svgPaths[1]
+    << svgPaths[2]
+    << svgPaths[3]
+    << svgPaths[4]
     << param->bodyColor.r
     << param->bodyColor.g
     << param->bodyColor.b
     << osc::EndMessage;
 }
 
-void OscController::bundleLight(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVLight* light, int paramId) {
+void OscController::bundleLight(osc::OutboundPacketStream& bundle, int64_t moduleId, const VCVLight* light, int paramId) {
   bundle << osc::BeginMessage("/modules/light/add")
     << moduleId
     << paramId
@@ -249,17 +680,19 @@ void OscController::bundleLight(osc::OutboundPacketStream& bundle, int64_t modul
     << osc::EndMessage;
 }
 
-void OscController::bundleInput(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVPort* input) {
+void OscController::bundleInput(osc::OutboundPacketStream& bundle, const StringScope& scope, int64_t moduleId, const VCVPort* input) {
+  StringArg svgPath = internString(bundle, scope, input->svgPath);
   bundle << osc::BeginMessage("/modules/input/add") << moduleId;
-  bundlePort(bundle, input);
+  bundlePort(bundle, input, svgPath);
 }
 
-void OscController::bundleOutput(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVPort* output) {
+void OscController::bundleOutput(osc::OutboundPacketStream& bundle, const StringScope& scope, int64_t moduleId, const VCVPort* output) {
+  StringArg svgPath = internString(bundle, scope, output->svgPath);
   bundle << osc::BeginMessage("/modules/output/add") << moduleId;
-  bundlePort(bundle, output);
+  bundlePort(bundle, output, svgPath);
 }
 
-void OscController::bundlePort(osc::OutboundPacketStream& bundle, VCVPort* port) {
+void OscController::bundlePort(osc::OutboundPacketStream& bundle, const VCVPort* port, const StringArg& svgPath) {
   bundle << port->id
     << port->name.c_str()
     << port->description.c_str()
@@ -267,7 +700,7 @@ void OscController::bundlePort(osc::OutboundPacketStream& bundle, VCVPort* port)
     << port->box.pos.y
     << port->box.size.x
     << port->box.size.y
-    << port->svgPath.c_str()
+    << svgPath
     << port->bodyColor.r
     << port->bodyColor.g
     << port->bodyColor.b
@@ -275,7 +708,7 @@ void OscController::bundlePort(osc::OutboundPacketStream& bundle, VCVPort* port)
     << osc::EndMessage;
 }
 
-void OscController::bundleDisplay(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVDisplay* display) {
+void OscController::bundleDisplay(osc::OutboundPacketStream& bundle, int64_t moduleId, const VCVDisplay* display) {
   bundle << osc::BeginMessage("/modules/display/add")
     << moduleId
     << display->box.pos.x
@@ -285,20 +718,24 @@ void OscController::bundleDisplay(osc::OutboundPacketStream& bundle, int64_t mod
     << osc::EndMessage;
 }
 
-void OscController::bundleModule(osc::OutboundPacketStream& bundle, VCVModule* module) {
-  bundle << osc::BeginBundleImmediate
-    << osc::BeginMessage("/modules/add")
+void OscController::bundleModule(osc::OutboundPacketStream& bundle, const StringScope& scope, const VCVModule* module) {
+  StringArg brand = internString(bundle, scope, module->brand);
+  StringArg slug = internString(bundle, scope, module->slug);
+  StringArg pluginSlug = internString(bundle, scope, module->pluginSlug);
+  StringArg panelSvgPath = internString(bundle, scope, module->panelSvgPath);
+
+  bundle << osc::BeginMessage("/modules/add")
     << module->id
-    << module->brand.c_str()
+    << brand
     << module->name.c_str()
     << module->description.c_str()
-    << module->slug.c_str()
-    << module->pluginSlug.c_str()
+    << slug
+    << pluginSlug
     << module->box.pos.x
     << module->box.pos.y
     << module->box.size.x
     << module->box.size.y
-    << module->panelSvgPath.c_str()
+    << panelSvgPath
     << module->bodyColor.r
     << module->bodyColor.g
     << module->bodyColor.b
@@ -309,60 +746,123 @@ void OscController::bundleModule(osc::OutboundPacketStream& bundle, VCVModule* m
 }
  
 void OscController::enqueueSyncModule(int64_t moduleId) {
-  enqueueCommand(Command(CommandType::SyncModule, Payload(moduleId)));
-  /* enqueueCommand(Command( */
-  /*   CommandType::CheckModuleSync, */
-  /*   Payload(moduleId, getCurrentTime(), 0.2f) */
-  /* )); */
+  enqueueCommand(QueuedCommand(CommandType::SyncModule, moduleId));
 }
 
-void OscController::syncModule(VCVModule* module) {
-  osc::OutboundPacketStream bundle(oscBuffer, OSC_BUFFER_SIZE);
+// encodes on whichever thread it's called from, reads only `module`
+// and the (locked) string table
+void OscController::encodeModule(Bundler& bundler, const StringScope& scope, const VCVModule* module) {
+  bundler.begin();
 
-  bundle << osc::BeginBundleImmediate;
-  bundleModule(bundle, module);
+  bundleModule(bundler.beginGroup(), scope, module);
+  bundler.endGroup();
 
-  for (std::pair<int, VCVParam> p_param : module->Params) {
-    VCVParam* param = &p_param.second;
+  for (const std::pair<const int, VCVParam>& p_param : module->Params) {
+    const VCVParam* param = &p_param.second;
 
     if (param->type == ParamType::Unknown) {
       WARN("unknown param %d for %s, skipping bundle", param->id, module->name.c_str());
       continue;
     }
 
-    bundleParam(bundle, module->id, param);
+    // a param travels with its lights
+    osc::OutboundPacketStream& group = bundler.beginGroup();
+    bundleParam(group, scope, module->id, param);
 
-    for (std::pair<int, VCVLight> p_light : p_param.second.Lights) {
-      VCVLight* light = &p_light.second;
-      bundleLight(bundle, module->id, light, param->id);
+    for (const std::pair<const int, VCVLight>& p_light : p_param.second.Lights) {
+      bundleLight(group, module->id, &p_light.second, param->id);
     }
+    bundler.endGroup();
   }
 
-  for (std::pair<int, VCVPort> p_port : module->Inputs) {
-    bundleInput(bundle, module->id, &p_port.second);
+  for (const std::pair<const int, VCVPort>& p_port : module->Inputs) {
+    bundleInput(bundler.beginGroup(), scope, module->id, &p_port.second);
+    bundler.endGroup();
   }
 
-  for (std::pair<int, VCVPort> p_port : module->Outputs) {
-    bundleOutput(bundle, module->id, &p_port.second);
+  for (const std::pair<const int, VCVPort>& p_port : module->Outputs) {
+    bundleOutput(bundler.beginGroup(), scope, module->id, &p_port.second);
+    bundler.endGroup();
   }
 
-  for (std::pair<int, VCVLight> p_light : module->Lights) {
-    VCVLight* light = &p_light.second;
-    bundleLight(bundle, module->id, light);
+  for (const std::pair<const int, VCVLight>& p_light : module->Lights) {
+    bundleLight(bundler.beginGroup(), module->id, &p_light.second);
+    bundler.endGroup();
   }
 
   // TODO? generate id like for Lights
-  for (VCVDisplay& display : module->Displays) {
-    bundleDisplay(bundle, module->id, &display);
+  for (const VCVDisplay& display : module->Displays) {
+    bundleDisplay(bundler.beginGroup(), module->id, &display);
+    bundler.endGroup();
   }
 
-  bundle << osc::BeginMessage("/module_sync_complete")
+  bundler.beginGroup() << osc::BeginMessage("/module_sync_complete")
     << module->id
     << osc::EndMessage;
+  bundler.endGroup();
 
-  bundle << osc::EndBundle;
+  bundler.finish(module->id);
+}
+
+void OscController::clearStringTable() {
+  // cached syncs refer to ids the client no longer knows
+  Strings.clear();
+  bundleCache.clear();
+}
+
+void OscController::syncModules(const std::vector<ModuleSnapshot>& modules) {
+  if (stringTableCleared.exchange(false)) clearStringTable();
+  if (bundlePayloadChanged.exchange(false)) bundleCache.clear();
+  std::size_t payloadSize = bundlePayloadSize.load();
+
+  // only modules that changed since they were last sent get encoded
+  cachedBundles.clear();
+  encodeIndices.clear();
+  for (std::size_t i = 0; i < modules.size(); i++) {
+    cachedBundles.push_back(bundleCache.find(modules[i]->id, modules[i]->version));
+    if (!cachedBundles.back()) encodeIndices.push_back(i);
+  }
 
-  sendMessage(bundle);
+  while (encodeBundlers.size() < encodeIndices.size())
+    encodeBundlers.emplace_back(new Bundler(payloadSize));
+
+  EncoderPool::Job job = [&](int index) {
+    Bundler& bundler = *encodeBundlers[index];
+    std::size_t position = encodeIndices[index];
+    bundler.setMaxPayloadSize(payloadSize);
+    encodeModule(bundler, StringScope(modules[position]->id), modules[position].get());
+  };
+
+  // send each as soon as it's encoded, later ones keep encoding meanwhile
+  if (!encodeIndices.empty()) encoderPool.begin(encodeIndices.size(), job);
+  std::size_t encoded = 0;
+  for (std::size_t i = 0; i < modules.size(); i++) {
+    if (!cachedBundles[i]) {
+      encoderPool.wait(encoded);
+      cachedBundles[i] = bundleCache.store(modules[i]->id, modules[i]->version, *encodeBundlers[encoded]);
+      ++encoded;
+    }
+    sendChunks(cachedBundles[i]);
+  }
+  if (!encodeIndices.empty()) encoderPool.end();
+  cachedBundles.clear();
+}
+
+// `/bundle/max_payload <int bytes>`
+void OscController::setMaxBundlePayloadSize(int size) {
+  if (size < MIN_BUNDLE_PAYLOAD_SIZE || size > MAX_BUNDLE_PAYLOAD_SIZE) {
+    WARN("ignoring bundle payload size %d, must be %d to %d", size, MIN_BUNDLE_PAYLOAD_SIZE, MAX_BUNDLE_PAYLOAD_SIZE);
+    return;
+  }
+
+  bundlePayloadSize = size;
+  bundlePayloadChanged = true;
+  INFO("bundle payload size %d", size);
+}
+
+void OscController::setEncoderThreads(int count) {
+  encoderPool.setThreadCount(count);
+  INFO("%d encoder threads", encoderPool.getThreadCount());
 }
 
 rack::plugin::Model* OscController::findModel(std::string& pluginSlug, std::string& modelSlug) const {
@@ -407,18 +907,20 @@ void OscController::createModule(VCVModule& vcv_module) {
 
   if (moduleWidget) {
     Collectr.collectModule(Modules, module->id, vcv_module.returnId);
+    publishModule(module->id);
     enqueueSyncModule(module->id);
   }
 }
 
 void OscController::enqueueSyncCable(int64_t cableId) {
-  enqueueCommand(Command(CommandType::SyncCable, Payload(cableId)));
+  enqueueCommand(QueuedCommand(CommandType::SyncCable, cableId));
 }
 
-void OscController::syncCable(VCVCable* cable) {
+void OscController::syncCable(const VCVCable* cable) {
   /* DEBUG("syncing cable %lld", cable->id); */
 
-  osc::OutboundPacketStream buffer(oscBuffer, OSC_BUFFER_SIZE);
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream buffer(packet->data, packet->capacity);
 
   buffer << osc::BeginMessage("/cables/add")
     << cable->id
@@ -431,36 +933,56 @@ void OscController::syncCable(VCVCable* cable) {
     << cable->color.b
     << osc::EndMessage;
 
-  sendMessage(buffer);
+  sendMessage(packet, buffer);
 }
 
 void OscController::enqueueLightUpdates() {
-  enqueueCommand(Command(CommandType::UpdateLights, Payload()));
+  enqueueCommand(QueuedCommand(CommandType::UpdateLights));
+}
+
+void OscController::sampleLights() {
+  if (takeDue(SyncStream::LightStream)) lightSampler.sample(APP->engine);
+}
+
+// lmutex must be held
+std::size_t OscController::detectLightChanges() {
+  bool sampled = lightSampler.read(lightSamples);
+  return lightTable.detectChanges(sampled ? lightSamples.data() : nullptr);
+}
+
+void OscController::configureLights(int changeThreshold, int maxStaleFrames) {
+  std::lock_guard<std::mutex> lock(lmutex);
+  if (changeThreshold >= 0) lightTable.setChangeThreshold(changeThreshold);
+  if (maxStaleFrames >= 0) lightTable.setMaxStaleFrames(maxStaleFrames);
+  INFO("light change threshold %d, max stale frames %d", changeThreshold, maxStaleFrames);
 }
 
 void OscController::sendLightUpdates() {
+  if (lightFrames) {
+    sendLightFrames();
+    return;
+  }
+
   /* DEBUG("calling send light updates"); */
-  osc::OutboundPacketStream bundle(oscBuffer, OSC_BUFFER_SIZE);
+  std::lock_guard<std::mutex> lock(lmutex);
+  if (detectLightChanges() == 0) return;
+
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream bundle(packet->data, packet->capacity);
   bundle << osc::BeginBundleImmediate;
 
-  std::lock_guard<std::mutex> lock(lmutex);
-  for (std::pair<int64_t, LightReferenceMap> module_pair : LightReferences) {
-    int64_t& moduleId = module_pair.first;
-    for (std::pair<int, VCVLight*> light_pair : module_pair.second) {
-      int& lightId = light_pair.first;
-
-      VCVLight* vcv_light = light_pair.second;
-      if (!rack::color::isEqual(vcv_light->color, vcv_light->widget->color)) {
-        vcv_light->color = vcv_light->widget->color;
-        bundleLightUpdate(bundle, moduleId, lightId, vcv_light->color);
-      }
+  for (const LightTable::Segment& segment : lightTable.getSegments()) {
+    std::size_t end = segment.first + segment.count;
+    for (std::size_t i = lightTable.nextDirty(segment.first, end); i < end; i = lightTable.nextDirty(i + 1, end)) {
+      bundleLightUpdate(bundle, segment.moduleId, lightTable.getLightId(i), lightTable.getColor(i));
+      lightTable.markSent(i);
     }
   }
   bundle << osc::EndBundle;
 
   // 16 bytes is the size of an *empty* bundle
   /* DEBUG("light update bundle size: %lld", bundle.Size()); */
-  if(bundle.Size() > 16) sendMessage(bundle);
+  if(bundle.Size() > 16) sendMessage(packet, bundle);
 }
 
 void OscController::bundleLightUpdate(osc::OutboundPacketStream& bundle, int64_t moduleId, int lightId, NVGcolor color) {
@@ -474,10 +996,87 @@ void OscController::bundleLightUpdate(osc::OutboundPacketStream& bundle, int64_t
     << osc::EndMessage; // 28
 }
 
-void OscController::registerLightReference(int64_t moduleId, VCVLight* light) {
-  /* DEBUG("registering light %d", light->id); */
+static void writeLightRecord(std::vector<char>& records, uint16_t index, const NVGcolor& color) {
+  records.push_back(index & 0xff);
+  records.push_back(index >> 8);
+  records.push_back((char)(rack::math::clamp(color.r, 0.f, 1.f) * 255.f + 0.5f));
+  records.push_back((char)(rack::math::clamp(color.g, 0.f, 1.f) * 255.f + 0.5f));
+  records.push_back((char)(rack::math::clamp(color.b, 0.f, 1.f) * 255.f + 0.5f));
+  records.push_back((char)(rack::math::clamp(color.a, 0.f, 1.f) * 255.f + 0.5f));
+}
+
+// `/modules/lights/frame (<int64 moduleId> <blob records>)...`
+// records are 6 bytes: uint16 little-endian compact
+// light index (see sendLightIndex), then r, g, b, a as uint8.
+// modules are split across messages to keep each datagram under
+// LIGHT_FRAME_PAYLOAD_SIZE, a module with more than LIGHT_FRAME_MAX_RECORDS
+// changed lights is sent as several pairs.
+void OscController::sendLightFrames() {
+  PacketGuard packet;
+  osc::OutboundPacketStream message(nullptr, 0);
+
+  auto addRecords = [&](int64_t moduleId) {
+    if (packet.get() && message.Size() + lightFrameRecords.size() + 32 > LIGHT_FRAME_PAYLOAD_SIZE) {
+      message << osc::EndMessage;
+      sendMessage(packet, message);
+    }
+    if (!packet.get()) {
+      packet.reset(Transmittr.acquire());
+      message = osc::OutboundPacketStream(packet->data, packet->capacity);
+      message << osc::BeginMessage("/modules/lights/frame");
+    }
+
+    message << moduleId
+      << osc::Blob(lightFrameRecords.data(), lightFrameRecords.size());
+    lightFrameRecords.clear();
+  };
+
   std::lock_guard<std::mutex> lock(lmutex);
-  LightReferences[moduleId][light->id] = light;
+  if (detectLightChanges() == 0) return;
+
+  for (const LightTable::Segment& segment : lightTable.getSegments()) {
+    const int64_t& moduleId = segment.moduleId;
+    // lights past the last compact index never go out in frames
+    std::size_t end = segment.first + std::min(segment.count, (std::size_t)LIGHT_FRAME_MAX_LIGHTS);
+
+    lightFrameRecords.clear();
+    for (std::size_t i = lightTable.nextDirty(segment.first, end); i < end; i = lightTable.nextDirty(i + 1, end)) {
+      writeLightRecord(lightFrameRecords, i - segment.first, lightTable.getColor(i));
+      lightTable.markSent(i);
+      if (lightFrameRecords.size() >= LIGHT_FRAME_MAX_RECORDS * LIGHT_RECORD_SIZE) addRecords(moduleId);
+    }
+    if (!lightFrameRecords.empty()) addRecords(moduleId);
+  }
+
+  if (packet.get()) {
+    message << osc::EndMessage;
+    sendMessage(packet, message);
+  }
+}
+
+// `/modules/lights/index <int64 moduleId> <blob lightIds>`
+// the compact index used in light frames is the position of the
+// int32 little-endian light id in the blob.
+// lmutex must be held, so no frame for the module can go out before it
+void OscController::sendLightIndex(int64_t moduleId) {
+  std::vector<char> ids;
+
+  std::vector<int> lightIds;
+  if (!lightTable.getLightIds(moduleId, lightIds)) return;
+
+  if (lightIds.size() > LIGHT_FRAME_MAX_LIGHTS) lightIds.resize(LIGHT_FRAME_MAX_LIGHTS);
+  for (int lightId : lightIds) {
+    uint32_t id = lightId;
+    for (int i = 0; i < 4; i++) ids.push_back((id >> (i * 8)) & 0xff);
+  }
+
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream message(packet->data, packet->capacity);
+  message << osc::BeginMessage("/modules/lights/index")
+    << moduleId
+    << osc::Blob(ids.data(), ids.size())
+    << osc::EndMessage;
+  sendMessage(packet, message);
 }
 
 /* void OscController::sendModuleSyncComplete(int64_t moduleId) { */
@@ -490,103 +1089,238 @@ void OscController::registerLightReference(int64_t moduleId, VCVLight* light) {
 /*   sendMessage(message); */
 /* } */
 
-void OscController::sendMessage(osc::OutboundPacketStream packetStream) {
-  // this _looks like_ it only sends the data present and not the whole buffer? good.
+void OscController::sendMessage(PacketGuard& packet, const osc::OutboundPacketStream& packetStream) {
   /* DEBUG("data: %s, size: %lld", packetStream.Data(), packetStream.Size()); */
-  UdpTransmitSocket(unrealServerEndpoint).Send(packetStream.Data(), packetStream.Size());
+  packet->size = packetStream.Size();
+  Pacr.consume(packet->size);
+  Transmittr.send(packet.release());
 }
 
-// UE callbacks
-void OscController::rxModule(int64_t outerId, int innerId, float value) {
-  for (auto& pair : Modules[outerId].Lights) {
-    registerLightReference(outerId, &pair.second);
+void OscController::sendChunks(const Bundler& bundler) {
+  for (int i = 0; i < bundler.chunkCount(); i++) {
+    PacketGuard packet(Transmittr.acquire());
+    packet->size = bundler.writeChunk(i, packet->data, packet->capacity);
+    if (packet->size == 0) {
+      WARN("dropped oversized %lld byte bundle chunk", (long long)bundler.chunkSize(i));
+      continue;
+    }
+
+    Pacr.consume(packet->size);
+    Transmittr.send(packet.release());
   }
-  for (auto& pair : Modules[outerId].ParamLights) {
-    registerLightReference(outerId, pair.second);
+}
+
+void OscController::sendChunks(const BundleCache::Entry& bundle) {
+  for (int i = 0; i < bundle->chunkCount(); i++) {
+    Pacr.consume(bundle->chunkSize(i));
+    Transmittr.send(bundle->chunkData(i), bundle->chunkSize(i), bundle);
   }
+}
 
-  Modules[outerId].synced = true;
+// UE callbacks
+void OscController::rxModule(int64_t outerId, int innerId, float value) {
+  acknowledge(CommandType::SyncModule, outerId);
+  Strings.confirm(outerId);
+
+  // lights are read from the working copy, register on the UI thread.
+  // the client won't ack again, so this can't be dropped.
+  IngressCommand command(IngressType::ModuleSynced);
+  command.target.id = outerId;
+  ingress.pushReliable(command);
+}
+
+void OscController::moduleSynced(int64_t moduleId) {
+  if (Modules.count(moduleId) == 0) return;
+  VCVModule& module = Modules.at(moduleId);
+
+  std::vector<const VCVLight*> lights;
+  lights.reserve(module.Lights.size() + module.ParamLights.size());
+  for (auto& pair : module.Lights) lights.push_back(&pair.second);
+  for (auto& pair : module.ParamLights) lights.push_back(pair.second);
+
+  std::unique_lock<std::mutex> locker(lmutex);
+  lightTable.registerModule(moduleId, lights);
+  lightTable.setEvery(moduleId, lightEvery(interest.tierOf(moduleId)));
+  lightSampler.setLayout(lightTable.getSampledModules());
+  if (lightFrames) sendLightIndex(moduleId);
+  locker.unlock();
+
+  module.synced = true;
 }
 
 void OscController::rxCable(int64_t outerId, int innerId, float value) {
-  Cables[outerId].synced = true;
+  acknowledge(CommandType::SyncCable, outerId);
+
+  IngressCommand command(IngressType::CableSynced);
+  command.target.id = outerId;
+  ingress.pushReliable(command);
+}
+
+void OscController::rxMenu(int64_t outerId, int innerId, float value) {
+  acknowledge(CommandType::SyncMenu, outerId, innerId);
+}
+
+static void copySlug(char* destination, const std::string& slug) {
+  std::strncpy(destination, slug.c_str(), INGRESS_STRING_SIZE - 1);
+  destination[INGRESS_STRING_SIZE - 1] = '\0';
+}
+
+void OscController::pushIngress(const IngressCommand& command) {
+  if (!ingress.push(command))
+    WARN("ingress queue full, dropped command %d", command.type);
 }
 
 void OscController::addCableToCreate(int64_t inputModuleId, int64_t outputModuleId, int inputPortId, int outputPortId, NVGcolor color) {
-  std::lock_guard<std::mutex> lock(cablemutex);
   DEBUG("adding cable create to queue");
-  cablesToCreate.push_back(VCVCable(inputModuleId, outputModuleId, inputPortId, outputPortId, color));
+  IngressCommand command(IngressType::CreateCable);
+  command.cable.inputModuleId = inputModuleId;
+  command.cable.outputModuleId = outputModuleId;
+  command.cable.inputPortId = inputPortId;
+  command.cable.outputPortId = outputPortId;
+  command.cable.r = color.r;
+  command.cable.g = color.g;
+  command.cable.b = color.b;
+  pushIngress(command);
 }
 
 void OscController::addCableToDestroy(int64_t cableId) {
-  std::lock_guard<std::mutex> lock(cablemutex);
-  cablesToDestroy.push_back(cableId);
+  IngressCommand command(IngressType::DestroyCable);
+  command.target.id = cableId;
+  pushIngress(command);
 }
 
 void OscController::addModuleToCreate(const std::string& pluginSlug, const std::string& moduleSlug, const int& returnId) {
-  std::lock_guard<std::mutex> lock(modulemutex);
+  if (pluginSlug.size() >= INGRESS_STRING_SIZE || moduleSlug.size() >= INGRESS_STRING_SIZE) {
+    WARN("slug too long, not creating %s:%s", pluginSlug.c_str(), moduleSlug.c_str());
+    return;
+  }
+
   DEBUG("adding module create to queue");
-  modulesToCreate.push_back(VCVModule(moduleSlug, pluginSlug, returnId));
+  IngressCommand command(IngressType::CreateModule);
+  copySlug(command.module.pluginSlug, pluginSlug);
+  copySlug(command.module.moduleSlug, moduleSlug);
+  command.module.returnId = returnId;
+  pushIngress(command);
 }
 
 void OscController::addModulesToArrange(int64_t leftModuleId, int64_t rightModuleId, bool attach) {
-  std::lock_guard<std::mutex> lock(modulemutex);
   DEBUG("adding module arrange to queue");
-  modulesToArrange.push_back(std::tuple<int64_t, int64_t, bool>(leftModuleId, rightModuleId, attach));
+  IngressCommand command(IngressType::ArrangeModules);
+  command.arrange.leftModuleId = leftModuleId;
+  command.arrange.rightModuleId = rightModuleId;
+  command.arrange.attach = attach;
+  pushIngress(command);
 }
 
 void OscController::addModuleToDestroy(int64_t moduleId) {
-  std::lock_guard<std::mutex> lock(modulemutex);
-  modulesToDestroy.push_back(moduleId);
+  IngressCommand command(IngressType::DestroyModule);
+  command.target.id = moduleId;
+  pushIngress(command);
 }
 
 void OscController::addModuleToDiff(int64_t moduleId) {
-  std::lock_guard<std::mutex> lock(modulediffmutex);
-  pendingModuleDiffs.emplace(moduleId);
+  IngressCommand command(IngressType::DiffModule);
+  command.target.id = moduleId;
+  pushIngress(command);
 }
 
-void OscController::processCableUpdates() {
-  std::lock_guard<std::mutex> lock(cablemutex);
-  for (VCVCable cable_model : cablesToCreate) {
-    rack::engine::Cable* cable = new rack::engine::Cable;
-    cable->id = cable_model.id;
-    cable->inputModule = APP->engine->getModule(cable_model.inputModuleId);
-    cable->inputId = cable_model.inputPortId;
-    cable->outputModule = APP->engine->getModule(cable_model.outputModuleId);
-    cable->outputId = cable_model.outputPortId;
-    APP->engine->addCable(cable);
+void OscController::processIngress() {
+  ingress.drain(ingressCommands);
 
-    rack::app::CableWidget* cableWidget = new rack::app::CableWidget;
-		cableWidget->setCable(cable);
-		cableWidget->color = cable_model.color;
-		APP->scene->rack->addCable(cableWidget);
-
-    Collectr.collectCable(Cables, cable->id);
-    enqueueSyncCable(cable->id);
+  for (const IngressCommand& command : ingressCommands) {
+    switch (command.type) {
+      case IngressType::CreateCable:
+        createCable(command);
+        break;
+      case IngressType::DestroyCable:
+        destroyCable(command.target.id);
+        break;
+      case IngressType::CreateModule: {
+        VCVModule module_model(command.module.moduleSlug, command.module.pluginSlug, command.module.returnId);
+        createModule(module_model);
+        break;
+      }
+      case IngressType::DestroyModule:
+        destroyModule(command.target.id);
+        break;
+      case IngressType::ArrangeModules:
+        arrangeModules(command.arrange.leftModuleId, command.arrange.rightModuleId, command.arrange.attach);
+        break;
+      case IngressType::DiffModule:
+        if (std::find(pendingDiffs.begin(), pendingDiffs.end(), command.target.id) == pendingDiffs.end())
+          pendingDiffs.push_back(command.target.id);
+        break;
+      case IngressType::GetMenu: {
+        VCVMenu menu;
+        menu.moduleId = command.menu.moduleId;
+        menu.id = command.menu.menuId;
+        menu.parentMenuId = command.menu.parentMenuId;
+        menu.parentItemIndex = command.menu.parentItemIndex;
+
+        Collectr.collectMenu(ContextMenus, menu);
+        enqueueSyncMenu(menu.moduleId, menu.id);
+        break;
+      }
+      case IngressType::ClickMenuItem:
+        processMenuClick(command);
+        break;
+      case IngressType::UpdateMenuItemQuantity:
+        processMenuQuantityUpdate(command);
+        break;
+      case IngressType::UpdateParamPattern:
+      case IngressType::ResetParamPattern:
+        expandParamPattern(command);
+        break;
+      case IngressType::ModuleSynced:
+        moduleSynced(command.target.id);
+        break;
+      case IngressType::CableSynced:
+        if (Cables.count(command.target.id) > 0) Cables.at(command.target.id).synced = true;
+        break;
+      default:
+        break;
+    }
   }
-  cablesToCreate.clear();
+}
 
-  for (int64_t cableId : cablesToDestroy) {
-    rack::app::CableWidget* cw = APP->scene->rack->getCable(cableId);
-    APP->engine->removeCable(APP->engine->getCable(cableId));
-    APP->scene->rack->removeCable(cw);
+void OscController::createCable(const IngressCommand& command) {
+  VCVCable cable_model(
+    command.cable.inputModuleId,
+    command.cable.outputModuleId,
+    command.cable.inputPortId,
+    command.cable.outputPortId,
+    nvgRGBf(command.cable.r, command.cable.g, command.cable.b)
+  );
 
-    Cables.erase(cableId);
-  }
-  cablesToDestroy.clear();
+  rack::engine::Cable* cable = new rack::engine::Cable;
+  cable->id = cable_model.id;
+  cable->inputModule = APP->engine->getModule(cable_model.inputModuleId);
+  cable->inputId = cable_model.inputPortId;
+  cable->outputModule = APP->engine->getModule(cable_model.outputModuleId);
+  cable->outputId = cable_model.outputPortId;
+  APP->engine->addCable(cable);
+
+  rack::app::CableWidget* cableWidget = new rack::app::CableWidget;
+  cableWidget->setCable(cable);
+  cableWidget->color = cable_model.color;
+  APP->scene->rack->addCable(cableWidget);
+
+  Collectr.collectCable(Cables, cable->id);
+  publishCable(cable->id);
+  enqueueSyncCable(cable->id);
 }
 
-void OscController::processMenuRequests() {
-  std::lock_guard<std::mutex> lock(menumutex);
-  for (VCVMenu& menu : menusToSync) {
-    Collectr.collectMenu(ContextMenus, menu);
-    enqueueSyncMenu(menu.moduleId, menu.id);
-  }
-  menusToSync.clear();
+void OscController::destroyCable(int64_t cableId) {
+  rack::app::CableWidget* cw = APP->scene->rack->getCable(cableId);
+  APP->engine->removeCable(APP->engine->getCable(cableId));
+  APP->scene->rack->removeCable(cw);
+
+  Cables.erase(cableId);
+  cableSnapshots.erase(cableId);
 }
 
 void OscController::enqueueSyncMenu(int64_t moduleId, int menuId) {
-  enqueueCommand(Command(CommandType::SyncMenu, Payload(moduleId, menuId)));
+  enqueueCommand(QueuedCommand(CommandType::SyncMenu, moduleId, menuId));
 }
 
 void OscController::syncMenu(int64_t moduleId, int menuId) {
@@ -599,7 +1333,8 @@ void OscController::syncMenu(int64_t moduleId, int menuId) {
 
   /* printMenu(menu); */
 
-  osc::OutboundPacketStream bundle(oscBuffer, OSC_BUFFER_SIZE);
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream bundle(packet->data, packet->capacity);
   bundle << osc::BeginBundleImmediate;
 
   // sync plugin with modules and module tags, one plugin at a time
@@ -631,7 +1366,7 @@ void OscController::syncMenu(int64_t moduleId, int menuId) {
     << menu.id
     << osc::EndMessage;
 
-  sendMessage(bundle);
+  sendMessage(packet, bundle);
 }
 
 void OscController::printMenu(VCVMenu& menu) {
@@ -664,138 +1399,504 @@ void OscController::printMenu(VCVMenu& menu) {
   DEBUG("\n");
 }
 
-void OscController::processModuleUpdates() {
-  std::lock_guard<std::mutex> lock(cablemutex);
-  for (VCVModule& module_model : modulesToCreate) createModule(module_model);
-  modulesToCreate.clear();
+void OscController::destroyModule(int64_t moduleId) {
+  rack::app::ModuleWidget* mw = APP->scene->rack->getModule(moduleId);
+  if (!mw) {
+    WARN("unable to find module %lld to destroy, aborting.", (long long)moduleId);
+    return;
+  }
+  mw->removeAction();
+
+  Modules.erase(moduleId);
+  moduleSnapshots.erase(moduleId);
+  bundleCache.erase(moduleId);
+  cleanupModule(moduleId);
+}
+
+void OscController::updateParam(int64_t outerId, int innerId, float value) {
+  paramUpdates.set(outerId, innerId, value);
+}
+
+static uint32_t readLittleEndian32(const unsigned char* bytes) {
+  return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
 
-  for (int64_t moduleId : modulesToDestroy) {
-    rack::app::ModuleWidget* mw = APP->scene->rack->getModule(moduleId);
-    mw->removeAction();
+#define PARAM_RECORD_SIZE 16
 
-    Modules.erase(moduleId);
-    cleanupModule(moduleId);
+// reads up to `max` records from an /update/params blob, advancing `record`
+static std::size_t readParamRecords(const unsigned char*& record, const unsigned char* end, ParamUpdate* updates, std::size_t max) {
+  std::size_t count = 0;
+  for (; count < max && record + PARAM_RECORD_SIZE <= end; record += PARAM_RECORD_SIZE) {
+    uint32_t value = readLittleEndian32(record + 12);
+
+    ParamUpdate& update = updates[count++];
+    update.moduleId = (int64_t)((uint64_t)readLittleEndian32(record) | (uint64_t)readLittleEndian32(record + 4) << 32);
+    update.paramId = (int32_t)readLittleEndian32(record + 8);
+    std::memcpy(&update.value, &value, sizeof(float));
   }
-  modulesToDestroy.clear();
+  return count;
+}
+
+// `/update/params <blob>`, the blob is packed 16 byte records of
+// int64 moduleId, int32 paramId, float32 value, all little-endian
+void OscController::updateParams(osc::Blob blob) {
+  const std::size_t BATCH_SIZE = 64;
+
+  if (blob.size % PARAM_RECORD_SIZE != 0)
+    WARN("/update/params blob of %d bytes isn't a whole number of records", (int)blob.size);
 
-  for (std::tuple<int64_t, int64_t, bool>& tuple : modulesToArrange)
-    arrangeModules(std::get<0>(tuple), std::get<1>(tuple), std::get<2>(tuple));
-  modulesToArrange.clear();
+  ParamUpdate batch[BATCH_SIZE];
+  const unsigned char* record = (const unsigned char*)blob.data;
+  const unsigned char* end = record + blob.size;
+
+  std::size_t count;
+  while ((count = readParamRecords(record, end, batch, BATCH_SIZE)) > 0)
+    paramUpdates.set(batch, count);
 }
 
-void OscController::updateParam(int64_t outerId, int innerId, float value) {
-  std::lock_guard<std::mutex> lock(pumutex);
-  Modules[outerId].Params[innerId].value = value;
-  pendingParamUpdates.emplace(outerId, innerId);
+static double timeTagToSeconds(osc::uint64 timeTag) {
+  return (double)(timeTag >> 32) + (double)(timeTag & 0xffffffff) / 4294967296.0;
+}
+
+static osc::uint64 secondsToTimeTag(double seconds) {
+  double whole = std::floor(seconds);
+  return (osc::uint64)whole << 32 | (osc::uint64)((seconds - whole) * 4294967296.0);
+}
+
+void OscController::scheduleParamUpdate(osc::TimeTag timeTag, int64_t moduleId, int paramId, float value) {
+  if (!paramScheduler.schedule(timeTagToSeconds(timeTag.value), ParamUpdate{moduleId, paramId, value}))
+    WARN("param scheduler full, dropped %lld:%d", (long long)moduleId, paramId);
+}
+
+void OscController::scheduleParamUpdates(osc::TimeTag timeTag, osc::Blob blob) {
+  double time = timeTagToSeconds(timeTag.value);
+
+  ParamUpdate update;
+  const unsigned char* record = (const unsigned char*)blob.data;
+  const unsigned char* end = record + blob.size;
+  while (readParamRecords(record, end, &update, 1) > 0) {
+    if (!paramScheduler.schedule(time, update)) {
+      WARN("param scheduler full, dropped %lld:%d", (long long)update.moduleId, update.paramId);
+      return;
+    }
+  }
+}
+
+static int64_t steadyNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Time::now().time_since_epoch()).count();
+}
+
+void OscController::processAudio(int64_t frame, float sampleTime) {
+  int64_t block = APP->engine->getBlock();
+  if (block != audioBlock) {
+    audioBlock = block;
+    rtStats.onBlock(steadyNs(), APP->engine->getBlockDuration());
+    paramScheduler.collect();
+  }
+
+  bool scheduled = paramScheduler.nextTime() != std::numeric_limits<double>::infinity();
+  bool lightsDue = streamDue[SyncStream::LightStream].load(std::memory_order_relaxed);
+  if (!scheduled && !lightsDue && paramWrites.empty()) return;
+
+  int64_t start = steadyNs();
+  applyParamWrites(start);
+  if (scheduled) processScheduledParamUpdates(frame, sampleTime);
+  if (lightsDue) sampleLights();
+  rtStats.onProcess(steadyNs() - start);
+}
+
+// process runs under the engine's lock, so modules are looked up without it
+void OscController::applyParamWrites(int64_t now) {
+  ParamWrite write;
+  while (paramWrites.pop(write)) {
+    const ParamUpdate& update = write.update;
+    rack::engine::Module* module = APP->engine->getModule_NoLock(update.moduleId);
+    if (!module || update.paramId < 0 || update.paramId >= (int)module->params.size()) continue;
+
+    APP->engine->setParamValue(module, update.paramId, update.value);
+    rtStats.onApplied(now - write.queued);
+    appliedParams.push(ParamWrite{update, now});
+  }
+}
+
+void OscController::processScheduledParamUpdates(int64_t frame, float sampleTime) {
+  double now = APP->engine->getBlockTime() + (frame - APP->engine->getBlockFrame()) * (double)sampleTime;
+
+  ParamUpdate update;
+  while (paramScheduler.popDue(now, update)) {
+    rack::engine::Module* module = APP->engine->getModule_NoLock(update.moduleId);
+    if (!module || update.paramId < 0 || update.paramId >= (int)module->params.size()) continue;
+
+    APP->engine->setParamValue(module, update.paramId, update.value);
+    // display value and the echo to the client catch up on the UI thread
+    appliedParams.push(ParamWrite{update, 0});
+  }
+}
+
+// clock thread
+void OscController::flushParamUpdates() {
+  if (paramUpdates.empty()) return;
+  paramUpdates.drain(flushedParamUpdates);
+
+  // nothing drains the ring while the engine is paused
+  rack::engine::Engine* engine = APP->engine;
+  if (engine->isPaused()) {
+    for (const ParamUpdate& update : flushedParamUpdates) {
+      rack::engine::Module* module = engine->getModule(update.moduleId);
+      if (!module || update.paramId < 0 || update.paramId >= (int)module->params.size()) continue;
+
+      engine->setParamValue(module, update.paramId, update.value);
+      paramEchoes.set(update.moduleId, update.paramId, update.value);
+    }
+    return;
+  }
+
+  int64_t now = steadyNs();
+  for (std::size_t i = 0; i < flushedParamUpdates.size(); i++) {
+    if (paramWrites.push(ParamWrite{flushedParamUpdates[i], now})) continue;
+
+    // the rest go on the next tick
+    paramUpdates.set(flushedParamUpdates.data() + i, flushedParamUpdates.size() - i);
+    break;
+  }
+}
+
+void OscController::sendRtStats() {
+  RtStats::Snapshot stats = rtStats.take();
+  int64_t dropped = appliedParams.getDropped();
+  IngressQueue::Stats ingressStats = ingress.getStats();
+  PacketPool::Stats poolStats = Transmittr.getPoolStats();
+  double pacerRate = Pacr.getRate();
+  double pacerTokens = Pacr.getTokens();
+  uint64_t giveUps = syncGiveUps.load(std::memory_order_relaxed);
+
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream message(packet->data, packet->capacity);
+  message << osc::BeginMessage("/stats/rt")
+    << (int64_t)stats.blocks
+    << (int64_t)stats.lateBlocks
+    << (int64_t)stats.applied
+    << dropped
+    << (float)(stats.maxProcessNs / 1e3)
+    << (float)(stats.meanLatencyNs / 1e3)
+    << (float)(stats.maxLatencyNs / 1e3)
+    << (int64_t)ingressStats.pushed
+    << (int64_t)ingressStats.dropped
+    << (int64_t)ingressStats.coalesced
+    << (int64_t)ingressStats.overflowed
+    << (int64_t)poolStats.inUse
+    << (int64_t)poolStats.peakInUse
+    << (int64_t)poolStats.overflowed
+    << (float)pacerRate
+    << (float)pacerTokens
+    << (int64_t)giveUps
+    << osc::EndMessage;
+  sendMessage(packet, message);
+
+  INFO(
+    "rt: %llu blocks, %llu late, %llu params applied, %lld dropped, max process %.1fus, param latency %.1fus mean %.1fus max",
+    (unsigned long long)stats.blocks, (unsigned long long)stats.lateBlocks, (unsigned long long)stats.applied, (long long)dropped,
+    stats.maxProcessNs / 1e3, stats.meanLatencyNs / 1e3, stats.maxLatencyNs / 1e3
+  );
+  INFO(
+    "ingress: %llu pushed, %llu dropped, %llu coalesced, %llu overflowed",
+    (unsigned long long)ingressStats.pushed, (unsigned long long)ingressStats.dropped,
+    (unsigned long long)ingressStats.coalesced, (unsigned long long)ingressStats.overflowed
+  );
+  INFO(
+    "packets: %zu of %zu in use, %zu at most, %llu acquired, %llu from the heap",
+    poolStats.inUse, poolStats.capacity, poolStats.peakInUse,
+    (unsigned long long)poolStats.acquired, (unsigned long long)poolStats.overflowed
+  );
+  INFO("pacer: %.0f bytes/s, %.0f bytes in the bucket", pacerRate, pacerTokens);
+  INFO("syncs: gave up on %llu", (unsigned long long)giveUps);
+}
+
+// `/clock/sync <int64 token>` is answered with `/clock/sync <token> <timetag>`,
+// rack's clock as an osc timetag. the client estimates the offset from the
+// round trip and schedules bundles in rack time.
+void OscController::clockSync(int64_t token) {
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream message(packet->data, packet->capacity);
+  message << osc::BeginMessage("/clock/sync")
+    << token
+    << osc::TimeTag(secondsToTimeTag(rack::system::getTime()))
+    << osc::EndMessage;
+  sendMessage(packet, message);
+}
+
+void OscController::updateParamPattern(const char* modulePattern, const char* paramPattern, float value) {
+  if (!oscIsPattern(modulePattern) && !oscIsPattern(paramPattern)) {
+    updateParam(std::strtoll(modulePattern, nullptr, 10), std::strtol(paramPattern, nullptr, 10), value);
+    return;
+  }
+
+  if (std::strlen(modulePattern) >= INGRESS_STRING_SIZE || std::strlen(paramPattern) >= INGRESS_STRING_SIZE) {
+    WARN("pattern too long, not updating %s/%s", modulePattern, paramPattern);
+    return;
+  }
+
+  IngressCommand command(IngressType::UpdateParamPattern);
+  copySlug(command.param.modulePattern, modulePattern);
+  copySlug(command.param.paramPattern, paramPattern);
+  command.param.value = value;
+  pushIngress(command);
+}
+
+void OscController::resetParamPattern(const char* modulePattern, const char* paramPattern) {
+  if (std::strlen(modulePattern) >= INGRESS_STRING_SIZE || std::strlen(paramPattern) >= INGRESS_STRING_SIZE) {
+    WARN("pattern too long, not resetting %s/%s", modulePattern, paramPattern);
+    return;
+  }
+
+  IngressCommand command(IngressType::ResetParamPattern);
+  copySlug(command.param.modulePattern, modulePattern);
+  copySlug(command.param.paramPattern, paramPattern);
+  command.param.value = 0.f;
+  pushIngress(command);
+}
+
+void OscController::expandParamPattern(const IngressCommand& command) {
+  char id[32];
+  bool reset = command.type == IngressType::ResetParamPattern;
+
+  for (std::pair<const int64_t, VCVModule>& module_pair : Modules) {
+    snprintf(id, sizeof(id), "%lld", (long long)module_pair.first);
+    if (!oscPatternMatch(command.param.modulePattern, id)) continue;
+
+    for (std::pair<const int, VCVParam>& param_pair : module_pair.second.Params) {
+      snprintf(id, sizeof(id), "%d", param_pair.first);
+      if (!oscPatternMatch(command.param.paramPattern, id)) continue;
+
+      VCVParam& param = param_pair.second;
+      paramUpdates.set(module_pair.first, param_pair.first, reset ? param.defaultValue : command.param.value);
+    }
+  }
 }
 
 void OscController::processParamUpdates() {
-  if (pendingParamUpdates.empty()) return;
+  drainedParamUpdates.clear();
+  ParamWrite write;
+  while (appliedParams.pop(write)) drainedParamUpdates.push_back(write.update);
+  if (!drainedParamUpdates.empty()) paramEchoes.set(drainedParamUpdates.data(), drainedParamUpdates.size());
 
-  std::set<std::pair<int64_t, int>> paramUpdates;
-  std::unique_lock<std::mutex> locker(pumutex);
-  paramUpdates.swap(pendingParamUpdates);
-  locker.unlock();
+  if (paramEchoes.empty()) return;
+
+  paramEchoes.drain(drainedParamUpdates);
+  changedModules.clear();
 
-  for (const std::pair<int64_t, int>& pair : paramUpdates) {
-    const int64_t& moduleId = pair.first;
-    if (Modules.count(moduleId) == 0) continue;
+  for (ParamUpdate& update : drainedParamUpdates) {
+    const int64_t& moduleId = update.moduleId;
+    if (Modules.count(moduleId) == 0 || Modules[moduleId].Params.count(update.paramId) == 0) {
+      update.moduleId = -1;
+      continue;
+    }
 
-    const int& paramId = pair.second;
-    const float& value = Modules[moduleId].Params[paramId].value;
+    const int& paramId = update.paramId;
+    const float& value = update.value;
+    Modules[moduleId].Params[paramId].value = value;
 
-    APP->engine->setParamValue(APP->engine->getModule(moduleId), paramId, value);
     rack::engine::ParamQuantity* pq =
       APP->scene->rack->getModule(moduleId)->getParam(paramId)->getParamQuantity();
     Modules[moduleId].Params[paramId].displayValue = pq->getDisplayValueString();
-    enqueueSyncParam(moduleId, paramId);
+    markModuleChanged(Modules[moduleId]);
+  }
+
+  moduleSnapshots.publish(std::vector<const VCVModule*>(changedModules.begin(), changedModules.end()));
+  for (const ParamUpdate& update : drainedParamUpdates) {
+    if (update.moduleId != -1) enqueueSyncParam(update.moduleId, update.paramId);
   }
 }
 
-void OscController::processModuleDiffs() {
-  if (pendingModuleDiffs.empty()) return;
+void OscController::markModuleChanged(VCVModule& module) {
+  if (std::find(changedModules.begin(), changedModules.end(), &module) != changedModules.end()) return;
 
-  std::set<int64_t> moduleDiffs;
-  std::unique_lock<std::mutex> locker(modulediffmutex);
-  moduleDiffs.swap(pendingModuleDiffs);
-  locker.unlock();
+  stampModule(module);
+  changedModules.push_back(&module);
+}
 
-  for (const int64_t& moduleId : moduleDiffs) {
-    if (Modules.count(moduleId) == 0) continue;
+void OscController::processDiffs() {
+  if (pendingDiffs.empty()) return;
 
-    VCVModule& moduleThen = Modules.at(moduleId);
-    VCVModule moduleNow = Collectr.collectModule(moduleId);
+  changedModules.clear();
+  diffSyncs.clear();
+  for (int64_t moduleId : pendingDiffs) diffModule(moduleId);
+  pendingDiffs.clear();
 
-    auto aParams = moduleThen.getParams();
-    auto bParams = moduleNow.getParams();
-    for (auto& pair : aParams) {
-      int paramId = pair.first;
-      if (pair.second != bParams[paramId]) {
-        DEBUG("updating param %s from diff", pair.second.name.c_str());
-        moduleThen.Params[paramId].merge(moduleNow.Params[paramId]);
-        enqueueSyncParam(moduleId, paramId);
-      }
+  // every changed module in one publish, before any of their syncs
+  moduleSnapshots.publish(std::vector<const VCVModule*>(changedModules.begin(), changedModules.end()));
+  for (const QueuedCommand& sync : diffSyncs) {
+    if (sync.type == CommandType::SyncParam) {
+      enqueueSyncParam(sync.pid, sync.cid);
+    } else {
+      enqueueSyncPort(sync.pid, sync.cid, sync.portType);
     }
+  }
+}
 
-    auto aInputs = moduleThen.getInputs();
-    auto bInputs = moduleNow.getInputs();
-    for (auto& pair : aInputs) {
-      int inputId = pair.first;
-      if (pair.second != bInputs[inputId]) {
-        DEBUG("updating input %s from diff", pair.second.name.c_str());
-        moduleThen.Inputs[inputId].merge(moduleNow.Inputs[inputId]);
-        enqueueSyncPort(moduleId, inputId, moduleNow.Inputs[inputId].type);
-      }
+void OscController::diffModule(int64_t moduleId) {
+  if (Modules.count(moduleId) == 0) return;
+
+  VCVModule& moduleThen = Modules.at(moduleId);
+  VCVModule moduleNow = Collectr.collectModule(moduleId);
+  std::vector<int> changedParams;
+  std::vector<std::pair<int, PortType>> changedPorts;
+
+  auto aParams = moduleThen.getParams();
+  auto bParams = moduleNow.getParams();
+  for (auto& pair : aParams) {
+    int paramId = pair.first;
+    if (pair.second != bParams[paramId]) {
+      DEBUG("updating param %s from diff", pair.second.name.c_str());
+      moduleThen.Params[paramId].merge(moduleNow.Params[paramId]);
+      changedParams.push_back(paramId);
     }
+  }
 
-    auto aOutputs = moduleThen.getOutputs();
-    auto bOutputs = moduleNow.getOutputs();
-    for (auto& pair : aOutputs) {
-      int outputId = pair.first;
-      if (pair.second != bOutputs[outputId]) {
-        DEBUG("updating output %s from diff", pair.second.name.c_str());
-        moduleThen.Outputs[outputId].merge(moduleNow.Outputs[outputId]);
-        enqueueSyncPort(moduleId, outputId, moduleNow.Outputs[outputId].type);
-      }
+  auto aInputs = moduleThen.getInputs();
+  auto bInputs = moduleNow.getInputs();
+  for (auto& pair : aInputs) {
+    int inputId = pair.first;
+    if (pair.second != bInputs[inputId]) {
+      DEBUG("updating input %s from diff", pair.second.name.c_str());
+      moduleThen.Inputs[inputId].merge(moduleNow.Inputs[inputId]);
+      changedPorts.push_back(std::make_pair(inputId, moduleNow.Inputs[inputId].type));
     }
   }
+
+  auto aOutputs = moduleThen.getOutputs();
+  auto bOutputs = moduleNow.getOutputs();
+  for (auto& pair : aOutputs) {
+    int outputId = pair.first;
+    if (pair.second != bOutputs[outputId]) {
+      DEBUG("updating output %s from diff", pair.second.name.c_str());
+      moduleThen.Outputs[outputId].merge(moduleNow.Outputs[outputId]);
+      changedPorts.push_back(std::make_pair(outputId, moduleNow.Outputs[outputId].type));
+    }
+  }
+
+  if (changedParams.empty() && changedPorts.empty()) return;
+
+  markModuleChanged(moduleThen);
+  for (int paramId : changedParams)
+    diffSyncs.push_back(QueuedCommand(CommandType::SyncParam, moduleId, paramId));
+  for (std::pair<int, PortType>& port : changedPorts)
+    diffSyncs.push_back(QueuedCommand(CommandType::SyncPort, moduleId, port.first, port.second));
 }
 
 void OscController::enqueueSyncParam(int64_t moduleId, int paramId) {
-  enqueueCommand(Command(CommandType::SyncParam, Payload(moduleId, paramId)));
+  if (!interest.wants(moduleId)) {
+    interest.miss(moduleId);
+    return;
+  }
+  enqueueCommand(QueuedCommand(CommandType::SyncParam, moduleId, paramId));
 }
 
 void OscController::syncParam(int64_t moduleId, int paramId) {
-  if (Modules.count(moduleId) == 0) return;
+  ModuleSnapshot module = moduleSnapshots.get(moduleId);
+  if (!module || module->Params.count(paramId) == 0) return;
 
-  osc::OutboundPacketStream buffer(oscBuffer, OSC_BUFFER_SIZE);
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream buffer(packet->data, packet->capacity);
 
-  VCVParam& param = Modules[moduleId].Params[paramId];
+  const VCVParam& param = module->Params.at(paramId);
 
   buffer << osc::BeginMessage("/param/sync")
     << moduleId
     << paramId
-    << (param.displayValue.append(param.unit)).c_str()
+    << (param.displayValue + param.unit).c_str()
     << param.value
     << param.visible
     << osc::EndMessage;
 
-  sendMessage(buffer);
+  sendMessage(packet, buffer);
 }
 
 void OscController::enqueueSyncPort(int64_t moduleId, int portId, PortType type) {
-  enqueueCommand(Command(CommandType::SyncPort, Payload(moduleId, portId, type)));
+  if (!interest.wants(moduleId)) {
+    interest.miss(moduleId);
+    return;
+  }
+  enqueueCommand(QueuedCommand(CommandType::SyncPort, moduleId, portId, type));
+}
+
+// listener thread
+void OscController::subscribeModule(int64_t moduleId, int tier) {
+  if (moduleId < 0) {
+    WARN("not subscribing to module %lld", (long long)moduleId);
+    return;
+  }
+
+  std::vector<int64_t> arrived;
+  interest.subscribe(moduleId, tier, arrived);
+  applyInterest(arrived);
+}
+
+void OscController::unsubscribeModule(int64_t moduleId) {
+  std::vector<int64_t> arrived;
+  interest.unsubscribe(moduleId, arrived);
+  applyInterest(arrived);
+}
+
+#define INTEREST_RECORD_SIZE 12
+
+// `/interest/set <blob>`, the blob is packed 12 byte records of int64
+// moduleId, int32 tier, all little-endian. modules left out are
+// unsubscribed, an empty blob streams everything again.
+void OscController::setInterest(osc::Blob blob) {
+  if (blob.size % INTEREST_RECORD_SIZE != 0)
+    WARN("/interest/set blob of %d bytes isn't a whole number of records", (int)blob.size);
+
+  std::vector<std::pair<int64_t, int>> modules;
+  const unsigned char* record = (const unsigned char*)blob.data;
+  const unsigned char* end = record + blob.size;
+  for (; record + INTEREST_RECORD_SIZE <= end; record += INTEREST_RECORD_SIZE) {
+    int64_t moduleId = (int64_t)((uint64_t)readLittleEndian32(record) | (uint64_t)readLittleEndian32(record + 4) << 32);
+    if (moduleId < 0) continue;
+    modules.push_back(std::make_pair(moduleId, (int32_t)readLittleEndian32(record + 8)));
+  }
+
+  std::vector<int64_t> arrived;
+  interest.set(modules, arrived);
+  applyInterest(arrived);
+}
+
+// modules that just came into view get every light on the next frame,
+// and every param and port if they missed any syncs while away
+void OscController::applyInterest(const std::vector<int64_t>& arrived) {
+  std::unique_lock<std::mutex> locker(lmutex);
+  for (const LightTable::Segment& segment : lightTable.getSegments())
+    lightTable.setEvery(segment.moduleId, lightEvery(interest.tierOf(segment.moduleId)));
+  for (int64_t moduleId : arrived) lightTable.catchUp(moduleId);
+  locker.unlock();
+
+  for (int64_t moduleId : arrived) {
+    if (!interest.takeMissed(moduleId)) continue;
+
+    ModuleSnapshot module = moduleSnapshots.get(moduleId);
+    if (!module) continue;
+
+    DEBUG("catching up module %lld", (long long)moduleId);
+    for (const std::pair<const int, VCVParam>& param : module->Params)
+      enqueueCommand(QueuedCommand(CommandType::SyncParam, moduleId, param.first));
+    for (const std::pair<const int, VCVPort>& input : module->Inputs)
+      enqueueCommand(QueuedCommand(CommandType::SyncPort, moduleId, input.first, PortType::Input));
+    for (const std::pair<const int, VCVPort>& output : module->Outputs)
+      enqueueCommand(QueuedCommand(CommandType::SyncPort, moduleId, output.first, PortType::Output));
+  }
 }
 
 void OscController::syncPort(int64_t moduleId, int portId, PortType type) {
-  if (Modules.count(moduleId) == 0) return;
+  ModuleSnapshot module = moduleSnapshots.get(moduleId);
+  if (!module) return;
+
+  const std::map<int, VCVPort>& ports = type == PortType::Input ? module->Inputs : module->Outputs;
+  if (ports.count(portId) == 0) return;
 
-  osc::OutboundPacketStream buffer(oscBuffer, OSC_BUFFER_SIZE);
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream buffer(packet->data, packet->capacity);
 
-  VCVPort& port =
-    type == PortType::Input
-      ? Modules[moduleId].Inputs[portId]
-      : Modules[moduleId].Outputs[portId];
+  const VCVPort& port = ports.at(portId);
 
   buffer << osc::BeginMessage("/port/sync")
     << moduleId
@@ -804,11 +1905,11 @@ void OscController::syncPort(int64_t moduleId, int portId, PortType type) {
     << port.visible
     << osc::EndMessage;
 
-  sendMessage(buffer);
+  sendMessage(packet, buffer);
 }
 
 void OscController::enqueueSyncLibrary() {
-  enqueueCommand(Command(CommandType::SyncLibrary, Payload()));
+  enqueueCommand(QueuedCommand(CommandType::SyncLibrary));
 }
 
 std::string OscController::dumpLibraryJsonToFile() {
@@ -868,11 +1969,12 @@ std::string OscController::dumpLibraryJsonToFile() {
 }
 
 void OscController::syncLibrary() {
-  osc::OutboundPacketStream buffer(oscBuffer, OSC_BUFFER_SIZE);
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream buffer(packet->data, packet->capacity);
   buffer << osc::BeginMessage("/library/json_path")
     << dumpLibraryJsonToFile().c_str()
     << osc::EndMessage;
-  sendMessage(buffer);
+  sendMessage(packet, buffer);
 }
 
 void OscController::setModuleFavorite(std::string pluginSlug, std::string moduleSlug, bool favorite) {
@@ -885,68 +1987,71 @@ void OscController::setModuleFavorite(std::string pluginSlug, std::string module
   }
 }
 
-void OscController::addMenuToSync(VCVMenu menu) {
-  std::lock_guard<std::mutex> lock(menumutex);
-  menusToSync.push_back(menu);
+void OscController::addMenuToSync(const VCVMenu& menu) {
+  IngressCommand command(IngressType::GetMenu);
+  command.menu.moduleId = menu.moduleId;
+  command.menu.menuId = menu.id;
+  command.menu.parentMenuId = menu.parentMenuId;
+  command.menu.parentItemIndex = menu.parentItemIndex;
+  pushIngress(command);
 }
 
 void OscController::clickMenuItem(int64_t moduleId, int menuId, int menuItemIndex) {
-  std::lock_guard<std::mutex> lock(menuitemmutex);
-  pendingMenuClicks.emplace(moduleId, menuId, menuItemIndex);
+  IngressCommand command(IngressType::ClickMenuItem);
+  command.menuItem.moduleId = moduleId;
+  command.menuItem.menuId = menuId;
+  command.menuItem.itemIndex = menuItemIndex;
+  command.menuItem.value = 0.f;
+  pushIngress(command);
 }
 
 void OscController::updateMenuItemQuantity(int64_t moduleId, int menuId, int menuItemIndex, float value) {
-  std::lock_guard<std::mutex> lock(menuquantitymutex);
-  pendingMenuQuantityUpdates.emplace(moduleId, menuId, menuItemIndex, value);
+  IngressCommand command(IngressType::UpdateMenuItemQuantity);
+  command.menuItem.moduleId = moduleId;
+  command.menuItem.menuId = menuId;
+  command.menuItem.itemIndex = menuItemIndex;
+  command.menuItem.value = value;
+  pushIngress(command);
 }
 
-void OscController::processMenuClicks() {
-  if (pendingMenuClicks.empty()) return;
-
-  std::set<std::tuple<int64_t, int, int>> menuClicks;
-  std::unique_lock<std::mutex> locker(menuitemmutex);
-  menuClicks.swap(pendingMenuClicks);
-  locker.unlock();
-
-  for (const std::tuple<int64_t, int, int>& tuple : menuClicks) {
-    const int64_t& moduleId = std::get<0>(tuple);
-    const int& menuId = std::get<1>(tuple);
-    const int& menuItemIndex = std::get<2>(tuple);
+void OscController::processMenuClick(const IngressCommand& command) {
+  const int64_t& moduleId = command.menuItem.moduleId;
+  const int& menuId = command.menuItem.menuId;
+  const int& menuItemIndex = command.menuItem.itemIndex;
 
-    rack::ui::Menu* menu =
-      Collectr.findContextMenu(ContextMenus, ContextMenus.at(moduleId).at(menuId));
+  rack::ui::Menu* menu =
+    Collectr.findContextMenu(ContextMenus, ContextMenus.at(moduleId).at(menuId));
 
-    bool wasDeleteAction{false};
+  bool wasDeleteAction{false};
 
-    int index = -1;
-    for (rack::widget::Widget* menu_child : menu->children) {
-      if (++index != menuItemIndex) continue;
+  int index = -1;
+  for (rack::widget::Widget* menu_child : menu->children) {
+    if (++index != menuItemIndex) continue;
 
-      rack::ui::MenuItem* menuItem =
-        dynamic_cast<rack::ui::MenuItem*>(menu_child);
+    rack::ui::MenuItem* menuItem =
+      dynamic_cast<rack::ui::MenuItem*>(menu_child);
 
-      if (!menuItem) {
-        WARN("found menu selection is not a menu item");
-        break;
-      }
-
-      if (menuItem->text.compare(std::string("Delete")) == 0) 
-        wasDeleteAction = true;
-
-      menuItem->doAction(true);
+    if (!menuItem) {
+      WARN("found menu selection is not a menu item");
       break;
     }
 
-    // close menu
-    rack::ui::MenuOverlay* overlay = menu->getAncestorOfType<rack::ui::MenuOverlay>();
-    if (overlay) overlay->requestDelete();
+    if (menuItem->text.compare(std::string("Delete")) == 0) 
+      wasDeleteAction = true;
 
-    if (wasDeleteAction) {
-      cleanupModule(moduleId);
-    } else {
-      addMenuToSync(ContextMenus.at(moduleId).at(menuId));
-      addModuleToDiff(moduleId);
-    }
+    menuItem->doAction(true);
+    break;
+  }
+
+  // close menu
+  rack::ui::MenuOverlay* overlay = menu->getAncestorOfType<rack::ui::MenuOverlay>();
+  if (overlay) overlay->requestDelete();
+
+  if (wasDeleteAction) {
+    cleanupModule(moduleId);
+  } else {
+    addMenuToSync(ContextMenus.at(moduleId).at(menuId));
+    addModuleToDiff(moduleId);
   }
 
   diffModuleAndCablePresence();
@@ -954,8 +2059,13 @@ void OscController::processMenuClicks() {
 
 void OscController::cleanupModule(const int64_t& moduleId) {
   std::unique_lock<std::mutex> locker(lmutex);
-  LightReferences.erase(moduleId);
+  lightTable.eraseModule(moduleId);
+  lightSampler.setLayout(lightTable.getSampledModules());
   locker.unlock();
+
+  std::vector<int64_t> arrived;
+  interest.forget(moduleId, arrived);
+  if (!arrived.empty()) applyInterest(arrived);
 }
 
 void OscController::diffModuleAndCablePresence() {
@@ -977,10 +2087,17 @@ void OscController::diffModuleAndCablePresence() {
         collectedModuleIds.begin(), collectedModuleIds.end(),
         std::inserter(diff, diff.begin())
       );
+      std::vector<const VCVModule*> collected;
       for (const int64_t& moduleId : diff) {
         Collectr.collectModule(Modules, moduleId, 0);
-        enqueueSyncModule(moduleId);
+        if (Modules.count(moduleId) == 0) continue;
+
+        VCVModule& module = Modules.at(moduleId);
+        stampModule(module);
+        collected.push_back(&module);
       }
+      moduleSnapshots.publish(collected);
+      for (const VCVModule* module : collected) enqueueSyncModule(module->id);
     } else {
       // more collected modules than what rack actually reports,
       // signal UE to destroy
@@ -990,16 +2107,19 @@ void OscController::diffModuleAndCablePresence() {
         std::inserter(diff, diff.begin())
       );
 
-      osc::OutboundPacketStream bundle(oscBuffer, OSC_BUFFER_SIZE);
-      bundle << osc::BeginBundleImmediate;
+      Bundler bundler(bundlePayloadSize.load());
+      bundler.begin();
+      moduleSnapshots.erase(diff);
       for (const int64_t& moduleId : diff) {
         Modules.erase(moduleId);
-        bundle << osc::BeginMessage("/modules/destroy")
+        bundleCache.erase(moduleId);
+        bundler.beginGroup() << osc::BeginMessage("/modules/destroy")
           << moduleId
           << osc::EndMessage;
+        bundler.endGroup();
       }
-      bundle << osc::EndBundle;
-      sendMessage(bundle);
+      bundler.finish();
+      sendChunks(bundler);
     }
   }
 
@@ -1021,10 +2141,13 @@ void OscController::diffModuleAndCablePresence() {
         collectedCableIds.begin(), collectedCableIds.end(),
         std::inserter(diff, diff.begin())
       );
+      std::vector<const VCVCable*> collected;
       for (const int64_t& cableId : diff) {
         Collectr.collectCable(Cables, cableId);
-        enqueueSyncCable(cableId);
+        if (Cables.count(cableId) > 0) collected.push_back(&Cables.at(cableId));
       }
+      cableSnapshots.publish(collected);
+      for (const VCVCable* cable : collected) enqueueSyncCable(cable->id);
     } else {
       // more collected cables than what rack actually reports,
       // signal UE to destroy
@@ -1034,66 +2157,59 @@ void OscController::diffModuleAndCablePresence() {
         std::inserter(diff, diff.begin())
       );
 
-      osc::OutboundPacketStream bundle(oscBuffer, OSC_BUFFER_SIZE);
-      bundle << osc::BeginBundleImmediate;
+      Bundler bundler(bundlePayloadSize.load());
+      bundler.begin();
+      cableSnapshots.erase(diff);
       for (const int64_t& cableId : diff) {
         Cables.erase(cableId);
-        bundle << osc::BeginMessage("/cables/destroy")
+        bundler.beginGroup() << osc::BeginMessage("/cables/destroy")
           << cableId
           << osc::EndMessage;
+        bundler.endGroup();
       }
-      bundle << osc::EndBundle;
-      sendMessage(bundle);
+      bundler.finish();
+      sendChunks(bundler);
     }
   }
 }
 
-void OscController::processMenuQuantityUpdates() {
-  if (pendingMenuQuantityUpdates.empty()) return;
+void OscController::processMenuQuantityUpdate(const IngressCommand& command) {
+  const int64_t& moduleId = command.menuItem.moduleId;
+  const int& menuId = command.menuItem.menuId;
+  const int& menuItemIndex = command.menuItem.itemIndex;
+  const float& value = command.menuItem.value;
 
-  std::set<std::tuple<int64_t, int, int, float>> menuQuantityUpdates;
-  std::unique_lock<std::mutex> locker(menuquantitymutex);
-  menuQuantityUpdates.swap(pendingMenuQuantityUpdates);
-  locker.unlock();
-
-  for (const std::tuple<int64_t, int, int, float>& tuple : menuQuantityUpdates) {
-    const int64_t& moduleId = std::get<0>(tuple);
-    const int& menuId = std::get<1>(tuple);
-    const int& menuItemIndex = std::get<2>(tuple);
-    const float& value = std::get<3>(tuple);
-
-    VCVMenu& vcv_menu = ContextMenus.at(moduleId).at(menuId);
-    rack::ui::Menu* menu = Collectr.findContextMenu(ContextMenus, vcv_menu);
+  VCVMenu& vcv_menu = ContextMenus.at(moduleId).at(menuId);
+  rack::ui::Menu* menu = Collectr.findContextMenu(ContextMenus, vcv_menu);
 
-    int index = -1;
-    for (rack::widget::Widget* menu_child : menu->children) {
-      if (++index != menuItemIndex) continue;
+  int index = -1;
+  for (rack::widget::Widget* menu_child : menu->children) {
+    if (++index != menuItemIndex) continue;
 
-      rack::Quantity* quantity{nullptr};
+    rack::Quantity* quantity{nullptr};
 
-      if (rack::ui::Slider* slider = dynamic_cast<rack::ui::Slider*>(menu_child)) {
-        quantity = slider->quantity;
-      } else if (rack::ui::RadioButton* radioButton = dynamic_cast<rack::ui::RadioButton*>(menu_child)) {
-        quantity = radioButton->quantity;
-      } else if (rack::ui::Button* button = dynamic_cast<rack::ui::Button*>(menu_child)) {
-        quantity = button->quantity;
-      }
-
-      if (!quantity) {
-        WARN("found menu selection has no quantity");
-        break;
-      }
+    if (rack::ui::Slider* slider = dynamic_cast<rack::ui::Slider*>(menu_child)) {
+      quantity = slider->quantity;
+    } else if (rack::ui::RadioButton* radioButton = dynamic_cast<rack::ui::RadioButton*>(menu_child)) {
+      quantity = radioButton->quantity;
+    } else if (rack::ui::Button* button = dynamic_cast<rack::ui::Button*>(menu_child)) {
+      quantity = button->quantity;
+    }
 
-      quantity->setValue(value);
+    if (!quantity) {
+      WARN("found menu selection has no quantity");
       break;
     }
 
-    // close menu
-    rack::ui::MenuOverlay* overlay = menu->getAncestorOfType<rack::ui::MenuOverlay>();
-    if (overlay) overlay->requestDelete();
-
-    addMenuToSync(vcv_menu);
+    quantity->setValue(value);
+    break;
   }
+
+  // close menu
+  rack::ui::MenuOverlay* overlay = menu->getAncestorOfType<rack::ui::MenuOverlay>();
+  if (overlay) overlay->requestDelete();
+
+  addMenuToSync(vcv_menu);
 }
 
 void OscController::arrangeModules(int64_t leftModuleId, int64_t rightModuleId, bool attach) {
@@ -1137,12 +2253,13 @@ void OscController::savePatch() {
   saveAsPatchPath = "";
   needsSave = false;
 
-  osc::OutboundPacketStream buffer(oscBuffer, OSC_BUFFER_SIZE);
+  PacketGuard packet(Transmittr.acquire());
+  osc::OutboundPacketStream buffer(packet->data, packet->capacity);
 
   buffer << osc::BeginMessage("/confirm_saved")
     << osc::EndMessage;
 
-  sendMessage(buffer);
+  sendMessage(packet, buffer);
 }
 
 void OscController::autosaveAndExit() {
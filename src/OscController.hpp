@@ -6,11 +6,27 @@
 #include "VCVStructure.hpp"
 #include "OSCctrl/collector.hpp"
 #include "OSCctrl/bootstrapper.hpp"
+#include "OSCctrl/transmitter.hpp"
+#include "OSCctrl/bundler.hpp"
+#include "OSCctrl/shmtransport.hpp"
+#include "OSCctrl/commandqueue.hpp"
+#include "OSCctrl/stringtable.hpp"
+#include "OSCctrl/pacer.hpp"
+#include "OSCctrl/paramtable.hpp"
+#include "OSCctrl/paramscheduler.hpp"
+#include "OSCctrl/ingress.hpp"
+#include "OSCctrl/snapshots.hpp"
+#include "OSCctrl/encoderpool.hpp"
+#include "OSCctrl/bundlecache.hpp"
+#include "OSCctrl/lighttable.hpp"
+#include "OSCctrl/interest.hpp"
+#include "OSCctrl/syncclock.hpp"
+#include "OSCctrl/paramring.hpp"
+#include "OSCctrl/rtstats.hpp"
 
 #include <unordered_map>
 #include <vector>
 #include <thread>
-#include <queue>
 #include <chrono>
 #include <condition_variable>
 #include <set>
@@ -21,58 +37,49 @@ namespace rack {
   }
 }
 
-#define OSC_BUFFER_SIZE (1024 * 128)
-
-using Time = std::chrono::steady_clock;
-using float_sec = std::chrono::duration<float>;
-using float_time_point = std::chrono::time_point<Time, float_sec>;
-
-enum CommandType {
-  SyncCable,
-  SyncModule,
-  SyncLibrary,
-  UpdateLights,
-  SyncParam,
-  SyncPort,
-  SyncMenu,
-  Noop
-};
-struct Payload {
-  int64_t pid;
-  int cid, gcid;
-
-  float_time_point lastCheck;
-  float wait;
+class PacketListener;
 
-  int retried = 0;
-  int retryLimit = 10;
-
-  PortType portType;
-
-  Payload() {}
-  Payload(int64_t _pid) : pid(_pid) {}
-  Payload(int64_t _pid, int _cid) : pid(_pid), cid(_cid) {}
-  Payload(int64_t _pid, int _cid, PortType _portType) : pid(_pid), cid(_cid), portType(_portType) {}
-  Payload(int64_t _pid, float_time_point _lastCheck, float _wait) : pid(_pid), lastCheck(_lastCheck), wait(_wait) {}
-};
-typedef std::pair<CommandType, Payload> Command;
-
-typedef std::unordered_map<int, VCVLight*> LightReferenceMap;
+#define LIGHT_FRAME_PAYLOAD_SIZE (1024 * 32)
+#define LIGHT_RECORD_SIZE 6
+// most records in one (moduleId, blob) pair, so a pair always fits a frame
+#define LIGHT_FRAME_MAX_RECORDS ((LIGHT_FRAME_PAYLOAD_SIZE - 64) / LIGHT_RECORD_SIZE)
 
 struct OscController {
   OscController();
   ~OscController();
 
   IpEndpointName unrealServerEndpoint;
-
-  char* oscBuffer = new char[OSC_BUFFER_SIZE];
-  void sendMessage(osc::OutboundPacketStream packetStream);
+  Transmitter Transmittr;
+
+  // optional same-host transport, see setUnrealServerPort
+  ShmTransport Shm;
+  PacketListener* packetListener{nullptr};
+  void setPacketListener(PacketListener* listener) { packetListener = listener; }
+
+  // encode into a buffer from Transmittr.acquire(), ownership of
+  // the packet passes to the transmitter
+  void sendMessage(PacketGuard& packet, const osc::OutboundPacketStream& packetStream);
+  void sendChunks(const Bundler& bundler);
+  void sendChunks(const BundleCache::Entry& bundle);
+
+  // outbound rate limit, see Pacer
+  Pacer Pacr;
+  void setPacing(float bytesPerSecond, float burstBytes);
+
+  // module syncs are split into bundles of at most this many bytes.
+  // cached syncs were chunked for the old size, the queue worker drops
+  // them before its next sync.
+  std::atomic<std::size_t> bundlePayloadSize{DEFAULT_BUNDLE_PAYLOAD_SIZE};
+  std::atomic<bool> bundlePayloadChanged{false};
+  void setMaxBundlePayloadSize(int size);
 
   int64_t ctrlModuleId{-1};
   void setModuleId(const int64_t& moduleId) { ctrlModuleId = moduleId; }
   int ctrlListenPort{-1};
   void setListenPort(const int& listenPort) { ctrlListenPort = listenPort; }
-  void setUnrealServerPort(const int& port);
+  // options are the extra strings the client sent with its port,
+  // "shm" asks for the shared memory transport
+  void setUnrealServerPort(const int& port, const std::vector<std::string>& options = std::vector<std::string>());
 
   // filter OSCctrl from ModuleIds
   std::vector<int64_t> getModuleIds() {
@@ -86,43 +93,123 @@ struct OscController {
 
   std::thread queueWorker;
   std::atomic<bool> queueWorkerRunning;
-  std::queue<Command> commandQueue;
+  CommandQueue commandQueue;
+  // only taken to sleep and to wake the worker while it sleeps,
+  // enqueueing to a busy worker is lock-free
   std::mutex qmutex;
   std::condition_variable queueLockCondition;
-  float_time_point getCurrentTime();
-  void enqueueCommand(Command command);
+  std::atomic<bool> queueWorkerWaiting{false};
+
+  // paces light frames, param flushes and module diffs
+  SyncClock syncClock;
+  std::atomic<bool> streamDue[SYNC_STREAM_COUNT];
+  // true once per tick of the stream
+  bool takeDue(SyncStream stream) {
+    return streamDue[stream].load(std::memory_order_relaxed) && streamDue[stream].exchange(false);
+  }
+  void onSyncTick(SyncStream stream);
+  // `/sync/rate <string stream> <float hz>`, stream is lights, params or diffs
+  void setSyncRate(const char* stream, float hz);
+
+  Time::time_point getCurrentTime();
+  void enqueueCommand(const QueuedCommand& command);
+  void wakeQueueWorker();
+  template<typename Predicate>
+  void waitForQueue(std::unique_lock<std::mutex>& locker, const Time::time_point* deadline, Predicate predicate);
   void processQueue();
 
-  std::mutex pumutex;
-  std::set<std::pair<int64_t, int>> pendingParamUpdates;
+  // structural syncs (modules, cables, menus) are kept here until the
+  // client acks them, and are resent with backoff until retryLimit.
+  // menus are only tracked for clients that ack them, negotiated with
+  // "menu_acks" in the handshake, otherwise they're fire-and-forget.
+  std::atomic<bool> menuAcks{false};
+  std::mutex ackmutex;
+  std::vector<Command> awaitingAck;
+  std::atomic<uint64_t> syncGiveUps{0};
+  void awaitAck(CommandType type, int64_t pid, int cid = -1);
+  void acknowledge(CommandType type, int64_t pid, int cid = -1);
+  bool nextAckDeadline(Time::time_point& deadline);
+  void retryUnacknowledged();
+  void sendSyncGaveUp(CommandType type, int64_t pid, int cid);
+
+  // param values from the client are coalesced here, moved to the audio
+  // thread on every param tick and applied there, then handed back to
+  // the UI thread for display values and echoes
+  ParamUpdateTable paramUpdates;
+  // clock thread
+  std::vector<ParamUpdate> flushedParamUpdates;
+  void flushParamUpdates();
+  ParamRing paramWrites;
+  // applied on the audio thread, coalesced again for the UI thread
+  ParamRing appliedParams;
+  ParamUpdateTable paramEchoes;
+  std::vector<ParamUpdate> drainedParamUpdates;
+
+  // audio thread, every sample. applies param writes, runs the param
+  // scheduler and samples lights, and never locks, allocates or waits.
+  int64_t audioBlock{-1};
+  void processAudio(int64_t frame, float sampleTime);
+  void applyParamWrites(int64_t now);
+  RtStats rtStats;
+  // `/stats/rt` is answered with `/stats/rt <int64 blocks> <int64 lateBlocks>
+  // <int64 applied> <int64 dropped> <float maxProcessUs> <float meanLatencyUs>
+  // <float maxLatencyUs> <int64 ingressPushed> <int64 ingressDropped>
+  // <int64 ingressCoalesced> <int64 ingressOverflowed> <int64 packetsInUse>
+  // <int64 packetsPeakInUse> <int64 packetsFromHeap> <float pacerRate>
+  // <float pacerTokens> <int64 syncGiveUps>`, maxima and the mean
+  // are since the last ask, counts since startup
+  void sendRtStats();
+
+  // param changes from timetagged bundles. timetags are in rack's
+  // system::getTime() clock, which the client learns with /clock/sync.
+  ParamScheduler paramScheduler;
+  void scheduleParamUpdate(osc::TimeTag timeTag, int64_t moduleId, int paramId, float value);
+  void scheduleParamUpdates(osc::TimeTag timeTag, osc::Blob blob);
+  // audio thread
+  void processScheduledParamUpdates(int64_t frame, float sampleTime);
+  void clockSync(int64_t token);
+
+  // UI thread, display values and echoes for applied params
   void processParamUpdates();
+  // module/param id patterns from /update/param/#/# and /reset/param/#/#
+  void expandParamPattern(const IngressCommand& command);
   void enqueueSyncParam(int64_t moduleId, int paramId);
   void syncParam(int64_t moduleId, int paramId);
   void enqueueSyncPort(int64_t moduleId, int paramId, PortType type);
   void syncPort(int64_t moduleId, int portId, PortType type);
 
-  std::mutex cablemutex;
-  std::vector<VCVCable> cablesToCreate;
-  std::vector<int64_t> cablesToDestroy;
-  void processCableUpdates();
-
-  std::mutex modulemutex;
-  std::vector<VCVModule> modulesToCreate;
-  std::vector<int64_t> modulesToDestroy;
-  void processModuleUpdates();
+  // what the client is looking at, lights, param and port syncs for
+  // anything else are held back until it comes into view
+  Interest interest;
+  // `/subscribe/module <int64 moduleId> <int tier>`
+  void subscribeModule(int64_t moduleId, int tier);
+  // `/unsubscribe/module <int64 moduleId>`
+  void unsubscribeModule(int64_t moduleId);
+  void setInterest(osc::Blob blob);
+  void applyInterest(const std::vector<int64_t>& arrived);
+  // light frames between polls for an interest tier, 0 for none
+  static int lightEvery(int tier) { return tier < 0 ? 0 : 1 << tier; }
+
+  // everything the client asks of the UI thread besides param values,
+  // drained once per frame by processIngress
+  IngressQueue ingress;
+  std::vector<IngressCommand> ingressCommands;
+  void pushIngress(const IngressCommand& command);
+  void processIngress();
+
+  void createCable(const IngressCommand& command);
+  void destroyCable(int64_t cableId);
+  void destroyModule(int64_t moduleId);
   void cleanupModule(const int64_t& moduleId);
-
-  std::mutex menuitemmutex;
-  std::set<std::tuple<int64_t, int, int>> pendingMenuClicks;
-  void processMenuClicks();
-
-  std::mutex menuquantitymutex;
-  std::set<std::tuple<int64_t, int, int, float>> pendingMenuQuantityUpdates;
-  void processMenuQuantityUpdates();
-
-  std::mutex modulediffmutex;
-  std::set<int64_t> pendingModuleDiffs;
-  void processModuleDiffs();
+  void processMenuClick(const IngressCommand& command);
+  void processMenuQuantityUpdate(const IngressCommand& command);
+  void diffModule(int64_t moduleId);
+  // requested diffs wait for the next diff tick, UI thread. the changed
+  // modules are published together and their syncs enqueued after.
+  std::vector<int64_t> pendingDiffs;
+  std::vector<QueuedCommand> diffSyncs;
+  void processDiffs();
+  void markModuleChanged(VCVModule& module);
   void diffModuleAndCablePresence();
 
   std::mutex syncmutex;
@@ -133,38 +220,91 @@ struct OscController {
   Collector Collectr;
   Bootstrapper Bootstrappr;
 
+  // the working descriptors belong to the UI thread. anything else reads
+  // the published snapshots, so an entry is republished after it changes
+  // and before a sync for it is enqueued.
   std::unordered_map<int64_t, VCVModule> Modules;
+  ModuleSnapshots moduleSnapshots;
+  std::vector<VCVModule*> changedModules;
+  uint64_t moduleVersion{0};
   void collectModules();
+  void stampModule(VCVModule& module) { module.version = ++moduleVersion; }
+  void publishModule(int64_t moduleId);
 
   std::unordered_map<int64_t, VCVCable> Cables;
+  CableSnapshots cableSnapshots;
   void collectCables(bool printResults = false);
+  void publishCable(int64_t cableId);
   void printCables();
 
+  // registered on the UI thread, compared and sent from the queue worker
   std::mutex lmutex;
-  std::unordered_map<int64_t, LightReferenceMap> LightReferences;
-
-  void bundleLight(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVLight* light, int paramId = -1);
-  void bundleParam(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVParam* param);
-  void bundleInput(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVPort* input);
-  void bundleOutput(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVPort* output);
-  void bundlePort(osc::OutboundPacketStream& bundle, VCVPort* port);
-  void bundleDisplay(osc::OutboundPacketStream& bundle, int64_t moduleId, VCVDisplay* display);
-  void bundleModule(osc::OutboundPacketStream& bundle, VCVModule* module);
+  LightTable lightTable;
+  // engine light brightnesses, sampled on the engine thread
+  LightSampler lightSampler;
+  std::vector<float> lightSamples;
+  // engine thread, every sample. samples once per light tick.
+  void sampleLights();
+  std::size_t detectLightChanges();
+  // `/lights/config <int threshold> <int maxStaleFrames>`, a missing or
+  // negative argument leaves that setting alone
+  void configureLights(int changeThreshold, int maxStaleFrames);
+
+  // svg paths, brands and slugs go out as string table ids,
+  // negotiated with "strings" in the handshake
+  std::atomic<bool> internStrings{false};
+  // set by /strings/clear when the client has lost its table
+  std::atomic<bool> stringTableCleared{false};
+  StringTable Strings;
+  StringArg internString(osc::OutboundPacketStream& bundle, const StringScope& scope, const std::string& text);
+  void clearStrings(int64_t outerId, int innerId, float value);
+
+  void bundleLight(osc::OutboundPacketStream& bundle, int64_t moduleId, const VCVLight* light, int paramId = -1);
+  void bundleParam(osc::OutboundPacketStream& bundle, const StringScope& scope, int64_t moduleId, const VCVParam* param);
+  void bundleInput(osc::OutboundPacketStream& bundle, const StringScope& scope, int64_t moduleId, const VCVPort* input);
+  void bundleOutput(osc::OutboundPacketStream& bundle, const StringScope& scope, int64_t moduleId, const VCVPort* output);
+  void bundlePort(osc::OutboundPacketStream& bundle, const VCVPort* port, const StringArg& svgPath);
+  void bundleDisplay(osc::OutboundPacketStream& bundle, int64_t moduleId, const VCVDisplay* display);
+  void bundleModule(osc::OutboundPacketStream& bundle, const StringScope& scope, const VCVModule* module);
 
   void enqueueSyncModule(int64_t moduleId);
-  void syncModule(VCVModule* module);
+  void encodeModule(Bundler& bundler, const StringScope& scope, const VCVModule* module);
+
+  // runs of queued module syncs (a full patch sync, say) are encoded
+  // across the pool, each into its own bundler, and sent in queue order
+  EncoderPool encoderPool;
+  std::vector<std::unique_ptr<Bundler>> encodeBundlers;
+  std::vector<QueuedCommand> syncModuleCommands;
+  std::vector<ModuleSnapshot> syncModuleSnapshots;
+  // `/encoder/threads <int count>`, -1 picks from the core count and
+  // 0 encodes on the queue worker only
+  void setEncoderThreads(int count);
+  void syncModules(const std::vector<ModuleSnapshot>& modules);
+
+  // what unchanged modules were last sent as, replayed on resync
+  BundleCache bundleCache;
+  std::vector<BundleCache::Entry> cachedBundles;
+  std::vector<std::size_t> encodeIndices;
+  void clearStringTable();
   rack::plugin::Model* findModel(std::string& pluginSlug, std::string& moduleSlug) const;
   void createModule(VCVModule& vcv_module);
 
   void enqueueSyncCable(int64_t cableId);
-  void syncCable(VCVCable* cable);
+  void syncCable(const VCVCable* cable);
 
-  void registerLightReference(int64_t moduleId, VCVLight* light);
+  // UI thread, once the client has acked a module sync
+  void moduleSynced(int64_t moduleId);
 
   void sendLightUpdates();
   void enqueueLightUpdates();
   void bundleLightUpdate(osc::OutboundPacketStream& bundle, int64_t moduleId, int lightId, NVGcolor color);
 
+  // packed light frames, negotiated with "light_frames" in the handshake
+  std::atomic<bool> lightFrames{false};
+  std::vector<char> lightFrameRecords;
+  void sendLightFrames();
+  void sendLightIndex(int64_t moduleId);
+
   void enqueueSyncLibrary();
   void syncLibrary();
   // dump library info to a json file and return the path
@@ -173,9 +313,6 @@ struct OscController {
   // context menus
   std::unordered_map<int64_t, ModuleMenuMap> ContextMenus;
 
-  std::mutex menumutex;
-  std::vector<VCVMenu> menusToSync;
-  void processMenuRequests();
   void enqueueSyncMenu(int64_t moduleId, int menuId);
   void syncMenu(int64_t moduleId, int menuId);
   void printMenu(VCVMenu& menu);
@@ -183,8 +320,12 @@ struct OscController {
   // UE callbacks
   void rxModule(int64_t outerId, int innerId, float value);
   void rxCable(int64_t outerId, int innerId, float value);
+  void rxMenu(int64_t outerId, int innerId, float value);
 
   void updateParam(int64_t outerId, int innerId, float value);
+  void updateParams(osc::Blob blob);
+  void updateParamPattern(const char* modulePattern, const char* paramPattern, float value);
+  void resetParamPattern(const char* modulePattern, const char* paramPattern);
 
   void addCableToCreate(int64_t inputModuleId, int64_t outputModuleId, int inputPortId, int outputPortId, NVGcolor color);
   void addCableToDestroy(int64_t cableId);
@@ -195,7 +336,7 @@ struct OscController {
 
   void setModuleFavorite(std::string pluginSlug, std::string moduleSlug, bool favorite);
 
-  void addMenuToSync(VCVMenu menu);
+  void addMenuToSync(const VCVMenu& menu);
   void clickMenuItem(int64_t moduleId, int menuId, int menuItemIndex);
   void updateMenuItemQuantity(int64_t moduleId, int menuId, int menuItemIndex, float value);
 
@@ -217,7 +358,6 @@ struct OscController {
   }
   void cleanupCurrentPatchAndPrepareNext();
 
-  std::vector<std::tuple<int64_t, int64_t, bool>> modulesToArrange;
   void addModulesToArrange(int64_t leftModuleId, int64_t rightModuleId, bool attach);
   void arrangeModules(int64_t leftModuleId, int64_t rightModuleId, bool attach);
 };
@@ -0,0 +1,85 @@
+#include "OscPattern.hpp"
+
+#include <cstring>
+
+// matches a `[...]` set starting after the `[`, moves `pattern` past the `]`
+static bool matchSet(const char*& pattern, const char* patternEnd, char c) {
+  bool negate = pattern < patternEnd && *pattern == '!';
+  if (negate) ++pattern;
+
+  bool matched = false;
+  while (pattern < patternEnd && *pattern != ']') {
+    if (pattern + 2 < patternEnd && pattern[1] == '-' && pattern[2] != ']') {
+      if (pattern[0] <= c && c <= pattern[2]) matched = true;
+      pattern += 3;
+    } else {
+      if (*pattern == c) matched = true;
+      ++pattern;
+    }
+  }
+  if (pattern < patternEnd) ++pattern; // ]
+
+  return matched != negate;
+}
+
+bool oscPatternMatch(const char* pattern, const char* patternEnd, const char* name, const char* nameEnd) {
+  while (pattern < patternEnd) {
+    switch (*pattern) {
+      case '*': {
+        while (pattern < patternEnd && *pattern == '*') ++pattern;
+        if (pattern == patternEnd) return true;
+
+        for (const char* rest = name; rest <= nameEnd; ++rest) {
+          if (oscPatternMatch(pattern, patternEnd, rest, nameEnd)) return true;
+        }
+        return false;
+      }
+      case '?':
+        if (name == nameEnd) return false;
+        ++pattern;
+        ++name;
+        break;
+      case '[':
+        if (name == nameEnd) return false;
+        ++pattern;
+        if (!matchSet(pattern, patternEnd, *name)) return false;
+        ++name;
+        break;
+      case '{': {
+        const char* close = pattern;
+        while (close < patternEnd && *close != '}') ++close;
+
+        // try each alternative followed by the rest of the pattern
+        const char* alternative = pattern + 1;
+        while (alternative <= close) {
+          const char* alternativeEnd = alternative;
+          while (alternativeEnd < close && *alternativeEnd != ',') ++alternativeEnd;
+
+          std::size_t length = alternativeEnd - alternative;
+          if ((std::size_t)(nameEnd - name) >= length
+              && std::strncmp(alternative, name, length) == 0
+              && oscPatternMatch(close < patternEnd ? close + 1 : close, patternEnd, name + length, nameEnd)) {
+            return true;
+          }
+          alternative = alternativeEnd + 1;
+        }
+        return false;
+      }
+      default:
+        if (name == nameEnd || *pattern != *name) return false;
+        ++pattern;
+        ++name;
+        break;
+    }
+  }
+
+  return name == nameEnd;
+}
+
+bool oscPatternMatch(const char* pattern, const char* name) {
+  return oscPatternMatch(pattern, pattern + std::strlen(pattern), name, name + std::strlen(name));
+}
+
+bool oscIsPattern(const char* address) {
+  return std::strpbrk(address, "*?[]{}") != nullptr;
+}
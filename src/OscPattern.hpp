@@ -0,0 +1,15 @@
+#pragma once
+
+// OSC 1.0 address pattern matching, one address part at a time:
+//   ?        any single character
+//   *        any run of characters
+//   [abc]    one of the listed characters, `a-z` ranges, `[!...]` negates
+//   {foo,ba} one of the comma separated strings
+//
+// ranges are [begin, end), neither needs to be null terminated.
+bool oscPatternMatch(const char* pattern, const char* patternEnd, const char* name, const char* nameEnd);
+
+bool oscPatternMatch(const char* pattern, const char* name);
+
+// true if `address` contains any of the pattern characters above
+bool oscIsPattern(const char* address);
@@ -1,207 +1,327 @@
 #include "OscRouter.hpp"
 #include "OscController.hpp"
+#include "OscPattern.hpp"
 
 #include <cstring>
 
-void OscRouter::ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) {
-  (void) remoteEndpoint; // suppress unused parameter warning
+// handlers for routes that don't map straight onto a controller method
 
-  if (!controller) {
-    WARN("`OscController* controller` not set, cannot process message.");
-    return;
-  }
+static void setUnrealServerPort(OscController& controller, int unrealServerPort, std::vector<std::string> options) {
+  DEBUG("received /set_unreal_server_port %d", unrealServerPort);
+  controller.setUnrealServerPort(unrealServerPort, options);
+}
 
-  std::string path(message.AddressPattern());
-  if (path.compare(std::string("/set_unreal_server_port")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+static void createModule(OscController& controller, std::string pluginSlug, std::string moduleSlug, int returnId) {
+  DEBUG("received /create/module %s:%s", pluginSlug.c_str(), moduleSlug.c_str());
+  controller.addModuleToCreate(pluginSlug, moduleSlug, returnId);
+}
 
-    osc::uint32 unrealServerPort;
-    unrealServerPort = (arg++)->AsInt32();
+static void destroyModule(OscController& controller, int64_t moduleId) {
+  controller.addModuleToDestroy(moduleId);
+  DEBUG("received /destroy/module %lld", (long long)moduleId);
+}
 
-    DEBUG("received /set_unreal_server_port %d", unrealServerPort);
+static void createCable(OscController& controller, int64_t inputModuleId, int64_t outputModuleId, int inputPortId, int outputPortId, float r, float g, float b) {
+  NVGcolor color{nvgRGBAf(r, g, b, 1.f)};
+  controller.addCableToCreate(inputModuleId, outputModuleId, inputPortId, outputPortId, color);
+}
 
-    controller->setUnrealServerPort(unrealServerPort);
-    return;
-  } else if (path.compare(std::string("/create/module")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+static void diffModule(OscController& controller, int64_t moduleId) {
+  controller.addModuleToDiff(moduleId);
+  DEBUG("received /diff/module %lld", (long long)moduleId);
+}
 
-    std::string pluginSlug, moduleSlug;
-    pluginSlug = (arg++)->AsString();
-    moduleSlug = (arg++)->AsString();
-    int returnId = (arg++)->AsInt32();
+static void sync(OscController& controller) {
+  controller.needsSync = true;
+}
 
-    DEBUG("received /create/module %s:%s", pluginSlug.c_str(), moduleSlug.c_str());
-    controller->addModuleToCreate(pluginSlug, moduleSlug, returnId);
-    return;
-  } else if (path.compare(std::string("/destroy/module")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+static void getMenu(OscController& controller, int64_t moduleId, int menuId, int parentMenuId, int parentItemIndex) {
+  VCVMenu menu;
+  menu.moduleId = moduleId;
+  menu.id = menuId;
+  menu.parentMenuId = parentMenuId;
+  menu.parentItemIndex = parentItemIndex;
 
-    osc::uint64 moduleId;
-    moduleId = (arg++)->AsInt64();
+  DEBUG("received /get_menu %lld", (long long)menu.moduleId);
 
-    controller->addModuleToDestroy(moduleId);
-    DEBUG("received /destroy/module %lld", moduleId);
-    return;
-  } else if (path.compare(std::string("/create/cable")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+  controller.addMenuToSync(menu);
+}
 
-    osc::uint64 inputModuleId, outputModuleId;
-    osc::uint32 inputPortId, outputPortId;
-    inputModuleId = (arg++)->AsInt64();
-    outputModuleId = (arg++)->AsInt64();
-    inputPortId = (arg++)->AsInt32();
-    outputPortId = (arg++)->AsInt32();
+static void clickMenuItem(OscController& controller, int64_t moduleId, int menuId, int itemIndex) {
+  DEBUG("received /click_menu_item %lld", (long long)moduleId);
+  controller.clickMenuItem(moduleId, menuId, itemIndex);
+}
 
-    float r, g, b;
-    r = (arg++)->AsFloat();
-    g = (arg++)->AsFloat();
-    b = (arg++)->AsFloat();
+static void updateMenuItemQuantity(OscController& controller, int64_t moduleId, int menuId, int itemIndex, float value) {
+  DEBUG("received /update_menu_item_quantity %lld", (long long)moduleId);
+  controller.updateMenuItemQuantity(moduleId, menuId, itemIndex, value);
+}
 
-    NVGcolor color{nvgRGBAf(r, g, b, 1.f)};
+static void arrangeModules(OscController& controller, int64_t leftModuleId, int64_t rightModuleId, bool attach) {
+  DEBUG("received /arrange_modules");
+  controller.addModulesToArrange(leftModuleId, rightModuleId, attach);
+}
 
-    controller->addCableToCreate(inputModuleId, outputModuleId, inputPortId, outputPortId, color);
-    return;
-  } else if (path.compare(std::string("/destroy/cable")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+static void savePatch(OscController& controller, std::string patchPath) {
+  DEBUG("received /save_patch %s", patchPath.c_str());
+  controller.requestSave(patchPath);
+}
 
-    osc::uint64 cableId;
-    cableId = (arg++)->AsInt64();
+static void autosaveAndExit(OscController& controller, std::string patchPath) {
+  DEBUG("received /autosave_and_exit with nextpatch: \"%s\"", patchPath.c_str());
+  controller.setPatchToLoadNext(patchPath);
+  controller.requestExit();
+}
 
-    controller->addCableToDestroy(cableId);
-    return;
-  } else if (path.compare(std::string("/diff/module")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+OscRouter::OscRouter() {
+  AddRoute("/set_unreal_server_port", &setUnrealServerPort);
+  AddRoute("/create/module", &createModule);
+  AddRoute("/destroy/module", &destroyModule);
+  AddRoute("/create/cable", &createCable);
+  AddRoute("/destroy/cable", &OscController::addCableToDestroy);
+  AddRoute("/diff/module", &diffModule);
+  AddRoute("/sync", &sync);
+  AddRoute("/get_menu", &getMenu);
+  AddRoute("/click_menu_item", &clickMenuItem);
+  AddRoute("/update_menu_item_quantity", &updateMenuItemQuantity);
+  AddRoute("/favorite", &OscController::setModuleFavorite);
+  AddRoute("/arrange_modules", &arrangeModules);
+  AddRoute("/save_patch", &savePatch);
+  AddRoute("/autosave_and_exit", &autosaveAndExit);
+}
 
-    osc::uint64 moduleId;
-    moduleId = (arg++)->AsInt64();
+void OscRouter::ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) {
+  (void) remoteEndpoint; // suppress unused parameter warning
 
-    controller->addModuleToDiff(moduleId);
-    DEBUG("received /diff/module %lld", moduleId);
-    return;
-  } else if (path.compare(std::string("/sync")) == 0) {
-    controller->needsSync = true;
+  if (!controller) {
+    WARN("`OscController* controller` not set, cannot process message.");
     return;
-  } else if (path.compare(std::string("/get_menu")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+  }
 
-    VCVMenu menu;
-    menu.moduleId = (arg++)->AsInt64();
-    menu.id = (arg++)->AsInt32();
-    menu.parentMenuId = (arg++)->AsInt32();
-    menu.parentItemIndex = (arg++)->AsInt32();
+  try {
+    const Route* route = FindRoute(message.AddressPattern());
+    if (route && !route->captures) {
+      RouteContext context;
+      context.flags = route->flags;
+      route->invoke(controller, route->target, message, context);
+      return;
+    }
 
-    DEBUG("received /get_menu %lld", menu.moduleId);
+    if (MatchRoutes(message) == 0) DEBUG("no route for %s", message.AddressPattern());
+  } catch(osc::Exception& e) {
+    DEBUG("Error parsing OSC message %s: %s", message.AddressPattern(), e.what());
+  }
+}
 
-    controller->addMenuToSync(menu);
+void OscRouter::ProcessBundle(const osc::ReceivedBundle& bundle, const IpEndpointName& remoteEndpoint) {
+  // 1 is "immediately"
+  osc::uint64 timeTag = bundle.TimeTag();
+  if (timeTag == 1) {
+    osc::OscPacketListener::ProcessBundle(bundle, remoteEndpoint);
     return;
-  } else if (path.compare(std::string("/click_menu_item")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+  }
+
+  for (osc::ReceivedBundle::const_iterator element = bundle.ElementsBegin(); element != bundle.ElementsEnd(); ++element) {
+    if (element->IsBundle()) {
+      ProcessBundle(osc::ReceivedBundle(*element), remoteEndpoint);
+    } else {
+      ProcessScheduledMessage(osc::ReceivedMessage(*element), remoteEndpoint, timeTag);
+    }
+  }
+}
 
-    osc::uint64 moduleId;
-    moduleId = (arg++)->AsInt64();
+void OscRouter::ProcessScheduledMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint, osc::uint64 timeTag) {
+  const char* address = message.AddressPattern();
+  uint32_t hash = oscRouteHash(address);
 
-    osc::uint32 menuId, itemIndex;
-    menuId = (arg++)->AsInt32();
-    itemIndex = (arg++)->AsInt32();
+  for (int i = 0; i < scheduledRouteCount; i++) {
+    const Route& route = scheduledRoutes[i];
+    if (route.hash != hash || std::strcmp(route.address, address) != 0) continue;
 
-    DEBUG("received /click_menu_item %lld", moduleId);
+    if (!controller) return;
 
-    controller->clickMenuItem(moduleId, menuId, itemIndex);
+    RouteContext context;
+    context.timeTag = timeTag;
+    context.flags = route.flags;
+    try {
+      route.invoke(controller, route.target, message, context);
+    } catch(osc::Exception& e) {
+      DEBUG("Error parsing OSC message %s: %s", address, e.what());
+    }
     return;
-  } else if (path.compare(std::string("/update_menu_item_quantity")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
-
-    osc::uint64 moduleId;
-    moduleId = (arg++)->AsInt64();
+  }
 
-    osc::uint32 menuId, itemIndex;
-    menuId = (arg++)->AsInt32();
-    itemIndex = (arg++)->AsInt32();
+  // everything else isn't time sensitive enough to bother
+  ProcessMessage(message, remoteEndpoint);
+}
 
-    float value;
-    value = (arg++)->AsFloat();
+bool OscRouter::AddScheduledRoute(const char* address, RouteInvoker invoke, const RouteTarget& target, int flags) {
+  uint32_t hash = oscRouteHash(address);
 
-    DEBUG("received /update_menu_item_quantity %lld", moduleId);
+  for (int i = 0; i < scheduledRouteCount; i++) {
+    Route& route = scheduledRoutes[i];
+    if (route.hash == hash && std::strcmp(route.address, address) == 0) {
+      route.invoke = invoke;
+      route.target = target;
+      route.flags = flags;
+      return true;
+    }
+  }
 
-    controller->updateMenuItemQuantity(moduleId, menuId, itemIndex, value);
-    return;
-  } else if (path.compare(std::string("/favorite")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+  if (scheduledRouteCount == MAX_SCHEDULED_ROUTES) {
+    WARN("too many scheduled routes, not adding %s", address);
+    return false;
+  }
 
-    std::string pluginSlug, moduleSlug;
-    bool favorite;
+  Route& route = scheduledRoutes[scheduledRouteCount++];
+  route.hash = hash;
+  route.address = address;
+  route.invoke = invoke;
+  route.target = target;
+  route.flags = flags;
+  return true;
+}
 
-    pluginSlug = (arg++)->AsString();
-    moduleSlug = (arg++)->AsString();
-    favorite = (arg++)->AsBool();
+void OscRouter::SetController(OscController* controller) {
+  this->controller = controller;
+}
 
-    controller->setModuleFavorite(pluginSlug, moduleSlug, favorite);
-    return;
-  } else if (path.compare(std::string("/arrange_modules")) == 0) {
-    DEBUG("received /arrange_modules");
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+bool OscRouter::AddRoute(const char* address, RouteInvoker invoke, const RouteTarget& target, int flags) {
+  uint32_t hash = oscRouteHash(address);
+
+  for (int i = 0; i < ROUTE_TABLE_SIZE; i++) {
+    Route& route = routes[(hash + i) & (ROUTE_TABLE_SIZE - 1)];
+
+    if (route.address && route.hash == hash) {
+      if (std::strcmp(route.address, address) != 0) {
+        WARN("route %s collides with %s, not adding it", address, route.address);
+        return false;
+      }
+      // re-adding replaces the handler, the trie points at the same route
+      route.invoke = invoke;
+      route.target = target;
+      route.flags = flags;
+      return true;
+    }
 
-    osc::uint64 leftModuleId = (arg++)->AsInt64();
-    osc::uint64 rightModuleId = (arg++)->AsInt64();
-    bool attach = (arg++)->AsBool();
+    if (!route.address) {
+      // keep at least one slot empty so a miss always terminates
+      if (routeCount >= ROUTE_TABLE_SIZE - 1) break;
 
-    controller->addModulesToArrange(leftModuleId, rightModuleId, attach);
-    return;
-  } else if (path.compare(std::string("/save_patch")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+      route.hash = hash;
+      route.address = address;
+      route.invoke = invoke;
+      route.target = target;
+      route.flags = flags;
+      ++routeCount;
 
-    std::string patchPath;
-    patchPath = (arg++)->AsString();
+      InsertRoute(&route);
+      return true;
+    }
+  }
 
-    DEBUG("received /save_patch %s", patchPath.c_str());
-    controller->requestSave(patchPath);
-    return;
-  } else if (path.compare(std::string("/autosave_and_exit")) == 0) {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+  WARN("route table full, not adding %s", address);
+  return false;
+}
 
-    std::string patchPath;
-    patchPath = (arg++)->AsString();
+const Route* OscRouter::FindRoute(const char* address) const {
+  uint32_t hash = oscRouteHash(address);
 
-    DEBUG("received /autosave_and_exit with nextpatch: \"%s\"", patchPath.c_str());
-    controller->setPatchToLoadNext(patchPath);
-    controller->requestExit();
-    return;
-  } else if (routes.find(path) == routes.end()) {
-    DEBUG("no route for %s", path.c_str());
-    return;
+  for (int i = 0; i < ROUTE_TABLE_SIZE; i++) {
+    const Route& route = routes[(hash + i) & (ROUTE_TABLE_SIZE - 1)];
+    if (!route.address) return nullptr;
+    if (route.hash == hash && std::strcmp(route.address, address) == 0) return &route;
   }
+  return nullptr;
+}
 
-  try {
-    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+void OscRouter::InsertRoute(Route* route) {
+  RouteNode* node = &routeTrie;
 
-    // potentially skip getting args if none are present
-    // todo: implement basic route vs "full" route routemaps
-    osc::uint64 outerId = -1;
-    if (arg != message.ArgumentsEnd()) {
-      outerId = (arg++)->AsInt64();
-    }
-    osc::uint32 innerId = -1;
-    if (arg != message.ArgumentsEnd()) {
-      innerId = (arg++)->AsInt32();
+  const char* part = route->address;
+  while (*part == '/') {
+    ++part;
+    const char* partEnd = part;
+    while (*partEnd && *partEnd != '/') ++partEnd;
+    std::string name(part, partEnd);
+
+    if (name == ROUTE_CAPTURE) route->captures = true;
+
+    RouteNode* child = nullptr;
+    for (std::unique_ptr<RouteNode>& existing : node->children) {
+      if (existing->part == name) {
+        child = existing.get();
+        break;
+      }
     }
-    float value = -1.f;
-    if (arg != message.ArgumentsEnd()) {
-      value = (arg++)->AsFloat();
+    if (!child) {
+      node->children.emplace_back(new RouteNode);
+      child = node->children.back().get();
+      child->part = name;
     }
 
-    /* if (arg != message.ArgumentsEnd()) throw osc::ExcessArgumentException(); */
-
-    RouteAction action = routes[path];
-    (controller->*action)(outerId, innerId, value);
-  } catch(osc::Exception& e) {
-    DEBUG("Error parsing OSC message %s: %s", message.AddressPattern(), e.what());
+    node = child;
+    part = partEnd;
   }
+
+  node->route = route;
 }
 
-void OscRouter::SetController(OscController* controller) {
-  this->controller = controller;
+int OscRouter::MatchRoutes(const osc::ReceivedMessage& message) {
+  MatchState state;
+  state.message = &message;
+  state.pattern = oscIsPattern(message.AddressPattern());
+  state.partCount = 0;
+
+  const char* part = message.AddressPattern();
+  while (*part == '/') {
+    if (state.partCount == MAX_ROUTE_PARTS) return 0;
+
+    ++part;
+    const char* partEnd = part;
+    while (*partEnd && *partEnd != '/') ++partEnd;
+
+    state.parts[state.partCount] = part;
+    state.partEnds[state.partCount] = partEnd;
+    ++state.partCount;
+    part = partEnd;
+  }
+  if (*part) return 0;
+
+  return MatchRoutes(routeTrie, state, 0, 0);
 }
 
-void OscRouter::AddRoute(std::string address, RouteAction action) {
-  routes.insert(std::unordered_map<std::string, RouteAction>::value_type(address, action));
+int OscRouter::MatchRoutes(const RouteNode& node, MatchState& state, int depth, int captureCount) {
+  if (depth == state.partCount) {
+    if (!node.route) return 0;
+    if (state.pattern && !(node.route->flags & ROUTE_MATCHES_PATTERNS)) return 0;
+    RouteContext context;
+    context.captures = state.captures;
+    context.captureCount = captureCount;
+    context.flags = node.route->flags;
+    node.route->invoke(controller, node.route->target, *state.message, context);
+    return 1;
+  }
+
+  const char* part = state.parts[depth];
+  const char* partEnd = state.partEnds[depth];
+
+  int matched = 0;
+  for (const std::unique_ptr<RouteNode>& child : node.children) {
+    if (child->part == ROUTE_CAPTURE) {
+      std::size_t length = partEnd - part;
+      if (captureCount == MAX_ROUTE_CAPTURES || length >= MAX_ROUTE_CAPTURE_LENGTH) continue;
+
+      // handed over as sent, which may itself be a pattern
+      char* capture = state.captureBuffers[captureCount];
+      std::memcpy(capture, part, length);
+      capture[length] = '\0';
+      state.captures[captureCount] = capture;
+
+      matched += MatchRoutes(*child, state, depth + 1, captureCount + 1);
+    } else if (oscPatternMatch(part, partEnd, child->part.c_str(), child->part.c_str() + child->part.size())) {
+      matched += MatchRoutes(*child, state, depth + 1, captureCount);
+    }
+  }
+  return matched;
 }
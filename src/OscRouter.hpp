@@ -4,24 +4,279 @@
 #include "../dep/oscpack/ip/IpEndpointName.h"
 #include "../dep/oscpack/osc/OscReceivedElements.h"
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 struct OscController;
-  
-typedef void(OscController::*CableAction)(int64_t, int64_t, int, int);
-typedef std::unordered_map<std::string, CableAction> CableActionMap;
 
-typedef void(OscController::*RouteAction)(int64_t, int, float);
-typedef std::unordered_map<std::string, RouteAction> RouteMap;
+// 32 bit fnv-1a, constexpr so a literal address hashes at compile time
+constexpr uint32_t oscRouteHash(const char* address, uint32_t hash = 2166136261u) {
+  return *address ? oscRouteHash(address + 1, (hash ^ (uint8_t)*address) * 16777619u) : hash;
+}
+
+// a `#` part in a route's address matches any single part of an incoming
+// address (or pattern), which is handed to the handler ahead of the
+// message's arguments
+#define ROUTE_CAPTURE "#"
+#define MAX_ROUTE_CAPTURES 4
+#define MAX_ROUTE_CAPTURE_LENGTH 64
+#define MAX_ROUTE_PARTS 16
+
+// route flags
+// a missing argument decodes as -1/false/"" rather than throwing, for
+// the generic id/id/value routes that clients send short
+#define ROUTE_DEFAULT_ARGS (1 << 0)
+// an incoming address pattern may match the route. routes without it
+// are only reached by their exact address (captures included).
+#define ROUTE_MATCHES_PATTERNS (1 << 1)
+
+// what a message was received with besides its arguments
+struct RouteContext {
+  const char* const* captures{nullptr};
+  int captureCount{0};
+  // of the enclosing bundle, 1 means immediately
+  osc::uint64 timeTag{1};
+  int flags{0};
+};
+
+// decodes captured address parts then the message's arguments, in order.
+// a missing argument throws osc::MissingArgumentException unless the
+// route has ROUTE_DEFAULT_ARGS. an osc::TimeTag parameter gets the bundle's.
+struct RouteArgs {
+  osc::ReceivedMessageArgumentIterator arg, end;
+  const RouteContext& context;
+  const char* const* captures;
+  int captureCount;
+  int nextCapture{0};
+
+  RouteArgs(const osc::ReceivedMessage& message, const RouteContext& _context)
+    : arg(message.ArgumentsBegin()), end(message.ArgumentsEnd()), context(_context),
+      captures(_context.captures), captureCount(_context.captureCount) {}
+
+  const char* capture() { return nextCapture < captureCount ? captures[nextCapture++] : nullptr; }
+  bool done() const { return arg == end; }
+  // true if the argument is missing and should take its default
+  bool missing() const {
+    if (!done()) return false;
+    if (!(context.flags & ROUTE_DEFAULT_ARGS)) throw osc::MissingArgumentException();
+    return true;
+  }
+};
+
+template<typename T> struct RouteArg;
+
+template<> struct RouteArg<int64_t> {
+  static int64_t decode(RouteArgs& args) {
+    if (const char* part = args.capture()) return std::strtoll(part, nullptr, 10);
+    return args.missing() ? -1 : (args.arg++)->AsInt64();
+  }
+};
+template<> struct RouteArg<int> {
+  static int decode(RouteArgs& args) {
+    if (const char* part = args.capture()) return std::strtol(part, nullptr, 10);
+    return args.missing() ? -1 : (args.arg++)->AsInt32();
+  }
+};
+template<> struct RouteArg<float> {
+  static float decode(RouteArgs& args) {
+    if (const char* part = args.capture()) return std::strtof(part, nullptr);
+    return args.missing() ? -1.f : (args.arg++)->AsFloat();
+  }
+};
+template<> struct RouteArg<bool> {
+  static bool decode(RouteArgs& args) { return args.missing() ? false : (args.arg++)->AsBool(); }
+};
+// points into the received packet (or a captured part), only valid for the handler call
+template<> struct RouteArg<const char*> {
+  static const char* decode(RouteArgs& args) {
+    if (const char* part = args.capture()) return part;
+    return args.missing() ? "" : (args.arg++)->AsString();
+  }
+};
+template<> struct RouteArg<std::string> {
+  static std::string decode(RouteArgs& args) {
+    if (const char* part = args.capture()) return part;
+    return args.missing() ? "" : (args.arg++)->AsString();
+  }
+};
+template<> struct RouteArg<osc::TimeTag> {
+  static osc::TimeTag decode(RouteArgs& args) { return osc::TimeTag(args.context.timeTag); }
+};
+// points into the received packet, only valid for the handler call
+template<> struct RouteArg<osc::Blob> {
+  static osc::Blob decode(RouteArgs& args) {
+    osc::Blob blob(nullptr, 0);
+    if (!args.missing()) (args.arg++)->AsBlob(blob.data, blob.size);
+    return blob;
+  }
+};
+// takes all remaining arguments as strings
+template<> struct RouteArg<std::vector<std::string>> {
+  static std::vector<std::string> decode(RouteArgs& args) {
+    std::vector<std::string> strings;
+    while (!args.done()) strings.push_back((args.arg++)->AsString());
+    return strings;
+  }
+};
+
+template<std::size_t... I> struct RouteIndices {};
+template<std::size_t N, std::size_t... I> struct MakeRouteIndices : MakeRouteIndices<N - 1, N - 1, I...> {};
+template<std::size_t... I> struct MakeRouteIndices<0, I...> { typedef RouteIndices<I...> type; };
+
+// member function or free function taking the controller first,
+// copied in bytewise and read back out by the matching invoker
+union RouteTargetSize {
+  void (OscController::*member)();
+  void (*function)();
+};
+
+struct RouteTarget {
+  alignas(RouteTargetSize) char bytes[sizeof(RouteTargetSize)];
+
+  template<typename T>
+  void store(T action) {
+    static_assert(sizeof(T) <= sizeof(bytes), "route handler pointer too large");
+    std::memcpy(bytes, &action, sizeof(T));
+  }
+
+  template<typename T>
+  T load() const {
+    T action;
+    std::memcpy(&action, bytes, sizeof(T));
+    return action;
+  }
+};
+
+typedef void (*RouteInvoker)(OscController*, const RouteTarget&, const osc::ReceivedMessage&, const RouteContext&);
+
+template<typename... Args>
+struct RouteCall {
+  typedef std::tuple<typename std::decay<Args>::type...> Values;
+
+  // braced initialization guarantees left to right evaluation
+  static Values decode(const osc::ReceivedMessage& message, const RouteContext& context) {
+    RouteArgs args(message, context);
+    (void) args;
+    return Values{RouteArg<typename std::decay<Args>::type>::decode(args)...};
+  }
+
+  template<std::size_t... I>
+  static void member(OscController* controller, void (OscController::*action)(Args...), Values& values, RouteIndices<I...>) {
+    (controller->*action)(std::get<I>(values)...);
+  }
+
+  template<std::size_t... I>
+  static void function(OscController* controller, void (*action)(OscController&, Args...), Values& values, RouteIndices<I...>) {
+    action(*controller, std::get<I>(values)...);
+  }
+
+  static void invokeMember(OscController* controller, const RouteTarget& target, const osc::ReceivedMessage& message, const RouteContext& context) {
+    Values values = decode(message, context);
+    member(controller, target.load<void (OscController::*)(Args...)>(), values, typename MakeRouteIndices<sizeof...(Args)>::type());
+  }
+
+  static void invokeFunction(OscController* controller, const RouteTarget& target, const osc::ReceivedMessage& message, const RouteContext& context) {
+    Values values = decode(message, context);
+    function(controller, target.load<void (*)(OscController&, Args...)>(), values, typename MakeRouteIndices<sizeof...(Args)>::type());
+  }
+};
+
+// fixed size open addressed table keyed by the address hash. routes with
+// colliding hashes are refused when added, so a lookup is one hash of the
+// incoming address, a probe and a single strcmp to confirm.
+//
+// every route is also added to a trie of address parts, which is only
+// walked for addresses that contain pattern characters or that don't
+// match exactly (routes with `#` parts). a pattern invokes every route
+// it matches that has ROUTE_MATCHES_PATTERNS.
+#define ROUTE_TABLE_SIZE 64
+#define MAX_SCHEDULED_ROUTES 8
+
+struct Route {
+  uint32_t hash{0};
+  const char* address{nullptr};
+  RouteInvoker invoke{nullptr};
+  RouteTarget target;
+  int flags{0};
+  bool captures{false};
+};
+
+struct RouteNode {
+  std::string part;
+  Route* route{nullptr};
+  std::vector<std::unique_ptr<RouteNode>> children;
+};
 
 class OscRouter : public osc::OscPacketListener {
 public:
+  OscRouter();
+
   OscController* controller = NULL;
   void SetController(OscController* controller);
 
-  RouteMap routes;
-  void AddRoute(std::string address, RouteAction action);
+  // `address` must outlive the router, pass a literal.
+  // arguments are decoded to the handler's parameter types,
+  // `flags` are ROUTE_ flags.
+  template<typename... Args>
+  bool AddRoute(const char* address, void (OscController::*action)(Args...), int flags = 0) {
+    RouteTarget target;
+    target.store(action);
+    return AddRoute(address, &RouteCall<Args...>::invokeMember, target, flags);
+  }
+
+  template<typename... Args>
+  bool AddRoute(const char* address, void (*action)(OscController&, Args...), int flags = 0) {
+    RouteTarget target;
+    target.store(action);
+    return AddRoute(address, &RouteCall<Args...>::invokeFunction, target, flags);
+  }
+
+  // handles messages with this address in bundles with a real timetag,
+  // instead of the route added with AddRoute. the handler should take
+  // an osc::TimeTag first.
+  template<typename... Args>
+  bool AddScheduledRoute(const char* address, void (OscController::*action)(Args...), int flags = 0) {
+    RouteTarget target;
+    target.store(action);
+    return AddScheduledRoute(address, &RouteCall<Args...>::invokeMember, target, flags);
+  }
+
+  const Route* FindRoute(const char* address) const;
+  // returns the number of routes invoked
+  int MatchRoutes(const osc::ReceivedMessage& message);
 
   virtual void ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) override;
+  virtual void ProcessBundle(const osc::ReceivedBundle& bundle, const IpEndpointName& remoteEndpoint) override;
+
+private:
+  Route routes[ROUTE_TABLE_SIZE];
+  int routeCount{0};
+
+  Route scheduledRoutes[MAX_SCHEDULED_ROUTES];
+  int scheduledRouteCount{0};
+  bool AddScheduledRoute(const char* address, RouteInvoker invoke, const RouteTarget& target, int flags);
+  void ProcessScheduledMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint, osc::uint64 timeTag);
+
+  RouteNode routeTrie;
+
+  struct MatchState {
+    const osc::ReceivedMessage* message;
+    bool pattern;
+    const char* parts[MAX_ROUTE_PARTS];
+    const char* partEnds[MAX_ROUTE_PARTS];
+    int partCount;
+    char captureBuffers[MAX_ROUTE_CAPTURES][MAX_ROUTE_CAPTURE_LENGTH];
+    const char* captures[MAX_ROUTE_CAPTURES];
+  };
+
+  bool AddRoute(const char* address, RouteInvoker invoke, const RouteTarget& target, int flags);
+  void InsertRoute(Route* route);
+  int MatchRoutes(const RouteNode& node, MatchState& state, int depth, int captureCount);
 };
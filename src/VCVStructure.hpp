@@ -170,6 +170,8 @@ struct VCVModule {
   std::vector<VCVDisplay> Displays;
 
   bool synced{false};
+  // bumped by the controller whenever what a sync would send changes
+  uint64_t version{0};
 
   VCVModule() {}
   VCVModule(int64_t _id) : id(_id) {}
@@ -0,0 +1,115 @@
+// standalone stand-in for the unreal client's end of the shared memory
+// transport: does the udp handshake, attaches to the rings, asks for a
+// /sync over the inbound ring and prints everything that comes back.
+//
+//   make shmreader
+//   ./shmreader [rack listen port, default 7000] [reply port, default 7600] [-q]
+//
+// -q only prints a per-second summary instead of every packet.
+
+#include "../src/OSCctrl/shmring.hpp"
+#include "../dep/oscpack/ip/UdpSocket.h"
+#include "../dep/oscpack/osc/OscOutboundPacketStream.h"
+#include "../dep/oscpack/osc/OscPrintReceivedElements.h"
+#include "../dep/oscpack/osc/OscReceivedElements.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static volatile std::sig_atomic_t running = 1;
+static void stop(int) { running = 0; }
+
+int main(int argc, char* argv[]) {
+  int rackPort{7000}, replyPort{7600};
+  bool quiet{false};
+
+  std::vector<int> ports;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-q") == 0) quiet = true;
+    else ports.push_back(std::atoi(argv[i]));
+  }
+  if (ports.size() > 0) rackPort = ports[0];
+  if (ports.size() > 1) replyPort = ports[1];
+
+  std::signal(SIGINT, stop);
+
+  char buffer[1024 * 64];
+
+  UdpReceiveSocket replySocket(IpEndpointName("127.0.0.1", replyPort));
+  UdpTransmitSocket rackSocket(IpEndpointName("127.0.0.1", rackPort));
+
+  osc::OutboundPacketStream handshake(buffer, sizeof(buffer));
+  handshake << osc::BeginMessage("/set_unreal_server_port")
+    << replyPort
+    << "shm"
+    << osc::EndMessage;
+  rackSocket.Send(handshake.Data(), handshake.Size());
+  std::cout << "sent handshake to rack on " << rackPort << ", waiting for /shm/attach on " << replyPort << std::endl;
+
+  std::string txName, rxName;
+  while (running && txName.empty()) {
+    IpEndpointName from;
+    std::size_t size = replySocket.ReceiveFrom(from, buffer, sizeof(buffer));
+    if (size == 0) continue;
+
+    osc::ReceivedPacket packet(buffer, size);
+    std::cout << "udp: " << packet << std::endl;
+    if (!packet.IsMessage()) continue;
+
+    osc::ReceivedMessage message(packet);
+    if (std::strcmp(message.AddressPattern(), "/shm/attach") != 0) continue;
+
+    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+    txName = (arg++)->AsString();
+    rxName = (arg++)->AsString();
+  }
+  if (!running) return 0;
+
+  // rack's tx is our inbound, rack's rx our outbound
+  ShmRing inbound, outbound;
+  if (!inbound.open(txName) || !outbound.open(rxName)) {
+    std::cerr << "unable to attach to " << txName << " / " << rxName << std::endl;
+    return 1;
+  }
+
+  osc::OutboundPacketStream sync(buffer, sizeof(buffer));
+  sync << osc::BeginMessage("/sync") << osc::EndMessage;
+  outbound.write(sync.Data(), sync.Size());
+  std::cout << "attached, requested /sync over " << rxName << std::endl;
+
+  long long packets{0}, bytes{0};
+  std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+
+  while (running) {
+    std::size_t size = inbound.read(buffer, sizeof(buffer));
+    if (size == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } else {
+      packets++;
+      bytes += size;
+      if (!quiet) {
+        try {
+          std::cout << osc::ReceivedPacket(buffer, size) << std::endl;
+        } catch (osc::Exception& e) {
+          std::cerr << "malformed packet: " << e.what() << std::endl;
+        }
+      }
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (quiet && now - lastReport >= std::chrono::seconds(1)) {
+      std::cout << packets << " packets, " << bytes << " bytes, "
+        << inbound.getDropped() << " dropped by rack" << std::endl;
+      lastReport = now;
+    }
+  }
+
+  std::cout << packets << " packets, " << bytes << " bytes total" << std::endl;
+  return 0;
+}